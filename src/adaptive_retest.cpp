@@ -0,0 +1,134 @@
+#include "adaptive_retest.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace calibration {
+
+namespace {
+
+double Clamp01(double p) {
+    return std::min(std::max(p, 1e-9), 1.0 - 1e-9);
+}
+
+double LogOdds(double p) {
+    p = Clamp01(p);
+    return std::log(p / (1.0 - p));
+}
+
+double Probability(double logOdds) {
+    return 1.0 / (1.0 + std::exp(-logOdds));
+}
+
+} // namespace
+
+const char* RetestVerdictName(RetestVerdict verdict) {
+    switch (verdict) {
+    case RetestVerdict::Testing: return "testing";
+    case RetestVerdict::Pass: return "pass";
+    case RetestVerdict::Fail: return "fail";
+    case RetestVerdict::Undecided: return "undecided";
+    default: return "(unknown)";
+    }
+}
+
+AdaptiveRetest::AdaptiveRetest(int cols, int rows, const RetestConfig& config)
+    : cols_(std::max(cols, 1)), cells_(std::max(cols, 1) * std::max(rows, 1)), config_(config) {
+    const double h = Clamp01(config.hitRate);
+    const double f = Clamp01(config.falseMarkRate);
+    markLlr_ = std::log(h / f);
+    cleanLlr_ = std::log((1.0 - h) / (1.0 - f));
+    const double m = Clamp01(config.markedHitRate);
+    markedMarkLlr_ = std::log(m / f);
+    markedCleanLlr_ = std::log((1.0 - m) / (1.0 - f));
+    if (config.neighbourHitRate > 0.0) {
+        const double n = Clamp01(config.neighbourHitRate);
+        neighbourMarkLlr_ = std::log(n / f);
+        neighbourCleanLlr_ = std::log((1.0 - n) / (1.0 - f));
+    }
+    faultyLlr_ = LogOdds(config.confidence);
+
+    llr_.assign((size_t)cells_, LogOdds(config.unitFaultRate / cells_));
+    shown_.assign((size_t)cells_, 0);
+    marked_.assign((size_t)cells_, 0);
+    pass_.reserve((size_t)cells_);
+    for (int c = 0; c < cells_; ++c) pass_.push_back(c);
+}
+
+const std::vector<int>& AdaptiveRetest::NextPass() {
+    if (verdict_ != RetestVerdict::Testing) pass_.clear();
+    return pass_;
+}
+
+void AdaptiveRetest::Observe(int cell, bool marked) {
+    if (cell < 0 || cell >= cells_ || verdict_ != RetestVerdict::Testing) return;
+    if (marked_[(size_t)cell]) llr_[(size_t)cell] += marked ? markedMarkLlr_ : markedCleanLlr_;
+    else llr_[(size_t)cell] += marked ? markLlr_ : cleanLlr_;
+    const double neighbourLlr = marked ? neighbourMarkLlr_ : neighbourCleanLlr_;
+    ForEachNeighbour(cell, [&](int n) { llr_[(size_t)n] += neighbourLlr; });
+    shown_[(size_t)cell] = 1;
+    showings_++;
+    if (marked) {
+        marked_[(size_t)cell] = 1;
+        marks_++;
+    }
+}
+
+double AdaptiveRetest::FaultProbability(int cell) const {
+    if (cell < 0 || cell >= cells_) return 0.0;
+    return Probability(llr_[(size_t)cell]);
+}
+
+double AdaptiveRetest::ResidualRisk() const {
+    double sum = 0.0;
+    for (double llr : llr_) sum += Probability(llr);
+    return sum;
+}
+
+RetestVerdict AdaptiveRetest::FinishPass() {
+    if (verdict_ != RetestVerdict::Testing) return verdict_;
+    passes_++;
+
+    const auto worst = std::max_element(llr_.begin(), llr_.end());
+    if (*worst >= faultyLlr_) {
+        faultyCell_ = (int)(worst - llr_.begin());
+        verdict_ = RetestVerdict::Fail;
+    } else if (ResidualRisk() <= 1.0 - config_.confidence &&
+               std::find(shown_.begin(), shown_.end(), 0) == shown_.end()) {
+        verdict_ = RetestVerdict::Pass;
+    } else if (passes_ >= config_.maxPasses) {
+        verdict_ = RetestVerdict::Undecided;
+    } else {
+        PlanPass();
+    }
+    return verdict_;
+}
+
+// Left and right on the same row, above and below.
+template <typename F>
+void AdaptiveRetest::ForEachNeighbour(int cell, F f) const {
+    const int col = cell % cols_;
+    if (col > 0) f(cell - 1);
+    if (col < cols_ - 1 && cell + 1 < cells_) f(cell + 1);
+    if (cell - cols_ >= 0) f(cell - cols_);
+    if (cell + cols_ < cells_) f(cell + cols_);
+}
+
+void AdaptiveRetest::PlanPass() {
+    const double share = (1.0 - config_.confidence) / cells_;
+    std::vector<std::uint8_t> include((size_t)cells_, 0);
+    for (int c = 0; c < cells_; ++c) {
+        if (shown_[(size_t)c] && Probability(llr_[(size_t)c]) <= share) continue;
+        include[(size_t)c] = 1;
+        if (config_.neighbours && marked_[(size_t)c]) {
+            ForEachNeighbour(c, [&](int n) { include[(size_t)n] = 1; });
+        }
+    }
+
+    pass_.clear();
+    for (int c = 0; c < cells_; ++c) {
+        if (include[(size_t)c]) pass_.push_back(c);
+    }
+}
+
+} // namespace calibration
@@ -0,0 +1,117 @@
+#pragma once
+
+// Adaptive retest: instead of a fixed number of blind loops, repeat passes
+// cover only the cells that are still in doubt, and the unit is finished as
+// soon as the evidence is strong enough either way.
+//
+// Every time a cell has been shown (its walking step, ON and OFF) the
+// frontend reports whether it was marked: by the operator (a mark records the
+// lit cell) or by a readback that disagreed. Each cell runs a sequential
+// probability ratio test on these reports. Its log-likelihood ratio starts at
+// the prior odds of a cell being faulty, unitFaultRate / cells, so the chance
+// that the unit holds a fault does not grow with its size. It moves by
+// log(h / f) per mark and log((1 - h) / (1 - f)) per clean showing, where h is
+// the chance that a faulty cell is marked when shown and f the chance of a
+// false mark. Once a cell has been marked, the weaker markedHitRate stands in
+// for h: a fault that was seen once but not the next time is most likely one
+// that comes and goes, so a few clean showings must not clear it. The
+// operator also watches the cells around the lit one, so a showing can count
+// for its four neighbours too, with the weaker neighbourHitRate as h. That is
+// off by default: a fault that shows only on its own cell (stuck down, slow
+// rise) is never seen from a neighbour, and clean neighbour showings would
+// clear it without the cell ever being judged, breaking the pass bound below.
+//
+//   - A cell whose fault probability reaches `confidence` is faulty; the unit
+//     is rejected and testing stops.
+//   - The unit passes once every cell has been shown and the fault
+//     probabilities of all cells add up to no more than 1 - confidence (a
+//     bound on the chance that a fault is left, given unitFaultRate).
+//   - Otherwise the next pass shows every cell that has not been shown yet or
+//     still carries more than its share (1 - confidence) / cells of that
+//     budget. Neighbours of marked cells are added, because a mark on the lit
+//     cell may come from a pin next to it (crosstalk).
+//
+// At the defaults one clean pass halves the prior and accepts a good unit,
+// even with an operator who notices only half of the faults. A marked cell is
+// shown again, with its neighbours, until a second mark confirms it or a few
+// dozen clean showings clear it. Faults that draw no mark in the first pass
+// are the price of stopping early; unitFaultRate sets how much a clean pass
+// must prove.
+// Platform-independent; no clock, no I/O.
+
+#include <cstdint>
+#include <vector>
+
+namespace calibration {
+
+struct RetestConfig {
+    double confidence = 0.99;        // per-unit: reject / accept at this probability
+    double unitFaultRate = 0.015;    // chance that a unit has a faulty cell before testing
+    double hitRate = 0.5;            // chance a faulty cell is marked when shown once
+    double markedHitRate = 0.1;      // the same for a cell already marked: a fault that comes and goes
+    double neighbourHitRate = 0.0;   // chance a neighbour's showing is marked; 0: no evidence
+    double falseMarkRate = 0.001;    // chance a good cell is marked when shown once
+    int maxPasses = 40;              // undecided after this many: stop anyway
+    bool neighbours = true;          // retest the cells around a marked cell
+};
+
+enum class RetestVerdict {
+    Testing,
+    Pass,          // no fault left with the configured confidence
+    Fail,          // FaultyCell() is faulty with the configured confidence
+    Undecided      // maxPasses reached
+};
+
+class AdaptiveRetest {
+public:
+    AdaptiveRetest(int cols, int rows, const RetestConfig& config);
+
+    // Cells to show in the next pass, in row-major order; the first pass is
+    // the whole line. Empty once a verdict is reached.
+    const std::vector<int>& NextPass();
+
+    // One showing of a cell in the current pass.
+    void Observe(int cell, bool marked);
+
+    // Applies the pass's observations and decides; call after each pass.
+    RetestVerdict FinishPass();
+
+    RetestVerdict Verdict() const { return verdict_; }
+    int Passes() const { return passes_; }
+    int FaultyCell() const { return faultyCell_; }       // -1 unless Fail
+    double FaultProbability(int cell) const;
+    double ResidualRisk() const;                         // sum of fault probabilities
+
+    std::uint64_t Showings() const { return showings_; }
+    std::uint64_t Marks() const { return marks_; }
+
+private:
+    void PlanPass();
+    template <typename F> void ForEachNeighbour(int cell, F f) const;
+
+    int cols_;
+    int cells_;
+    RetestConfig config_;
+    double markLlr_;
+    double cleanLlr_;
+    double markedMarkLlr_;
+    double markedCleanLlr_;
+    double neighbourMarkLlr_ = 0.0;
+    double neighbourCleanLlr_ = 0.0;
+    double faultyLlr_;               // log odds at which a cell is faulty
+
+    std::vector<double> llr_;        // per cell, starts at the prior log odds
+    std::vector<std::uint8_t> shown_;
+    std::vector<std::uint8_t> marked_;
+    std::vector<int> pass_;
+
+    RetestVerdict verdict_ = RetestVerdict::Testing;
+    int passes_ = 0;
+    int faultyCell_ = -1;
+    std::uint64_t showings_ = 0;
+    std::uint64_t marks_ = 0;
+};
+
+const char* RetestVerdictName(RetestVerdict verdict);
+
+} // namespace calibration
@@ -0,0 +1,49 @@
+// Counting replacement for the global operator new/delete.
+//
+// Link this file into an executable to feed the per-thread counters in
+// alloc_stats.h. It forwards to malloc/free, so apart from the two counter
+// increments the allocation behaviour is unchanged. Over-aligned new keeps
+// the library default and is not counted.
+
+#include <cstdlib>
+#include <new>
+
+#include "alloc_stats.h"
+
+namespace {
+
+void* CountedAlloc(std::size_t size) {
+    calibration::AllocationCounters& c = calibration::ThreadAllocationCounters();
+    c.allocations++;
+    c.bytes += size;
+    return std::malloc(size ? size : 1);
+}
+
+[[maybe_unused]] const bool g_registered = (calibration::SetAllocationCountingActive(), true);
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    if (void* p = CountedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = CountedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
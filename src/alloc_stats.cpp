@@ -0,0 +1,26 @@
+#include "alloc_stats.h"
+
+#include <atomic>
+
+namespace calibration {
+
+namespace {
+
+thread_local AllocationCounters t_counters;
+std::atomic<bool> g_countingActive{ false };
+
+} // namespace
+
+AllocationCounters& ThreadAllocationCounters() {
+    return t_counters;
+}
+
+bool AllocationCountingActive() {
+    return g_countingActive.load(std::memory_order_relaxed);
+}
+
+void SetAllocationCountingActive() {
+    g_countingActive.store(true, std::memory_order_relaxed);
+}
+
+} // namespace calibration
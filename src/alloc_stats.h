@@ -0,0 +1,46 @@
+#pragma once
+
+// Per-thread heap allocation counters.
+//
+// The counters are only fed when the counting global operator new
+// (alloc_counting_new.cpp) is linked into the executable; the simulator links
+// it, the dialog does not. Without it every count stays zero and
+// AllocationCountingActive() is false.
+
+#include <cstdint>
+
+namespace calibration {
+
+struct AllocationCounters {
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+};
+
+// Allocations made by the calling thread so far.
+AllocationCounters& ThreadAllocationCounters();
+
+bool AllocationCountingActive();
+void SetAllocationCountingActive(); // called by the counting operator new's TU
+
+// Adds the calling thread's allocations during the scope to the given totals.
+class AllocationScope {
+public:
+    AllocationScope(std::uint64_t& allocations, std::uint64_t& bytes)
+        : allocations_(allocations), bytes_(bytes), start_(ThreadAllocationCounters()) {}
+
+    ~AllocationScope() {
+        const AllocationCounters& now = ThreadAllocationCounters();
+        allocations_ += now.allocations - start_.allocations;
+        bytes_ += now.bytes - start_.bytes;
+    }
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    std::uint64_t& allocations_;
+    std::uint64_t& bytes_;
+    const AllocationCounters start_;
+};
+
+} // namespace calibration
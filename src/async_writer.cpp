@@ -0,0 +1,139 @@
+#include "async_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+namespace {
+
+const SteadyClock g_clock{};
+
+} // namespace
+
+AsyncWriter::AsyncWriter(std::FILE* out, int buffers, std::size_t bufferBytes, int flushEveryMs)
+    : out_(out), bufferBytes_(std::max<std::size_t>(bufferBytes, 1)),
+      flushEveryMs_(std::max(flushEveryMs, 1)) {
+    const int n = std::max(buffers, 2);
+    buffers_.resize((size_t)n);
+    free_.reserve((size_t)n);
+    queued_.reserve((size_t)n);
+    for (int i = n - 1; i >= 0; --i) {
+        buffers_[(size_t)i].data.reset(new char[bufferBytes_]);
+        free_.push_back(i);
+    }
+    thread_ = std::thread([this] { Run(); });
+}
+
+AsyncWriter::~AsyncWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void AsyncWriter::Append(const char* data, std::size_t len) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stats_.appends++;
+    stats_.bytes += len;
+
+    while (len > 0) {
+        if (current_ < 0) {
+            if (free_.empty()) {
+                const std::int64_t t0 = g_clock.NowUs();
+                freed_.wait(lock, [this] { return !free_.empty(); });
+                stats_.stalls++;
+                stats_.stallUs += g_clock.NowUs() - t0;
+            }
+            current_ = free_.back();
+            free_.pop_back();
+        }
+
+        Buffer& b = buffers_[(size_t)current_];
+        const std::size_t n = std::min(len, bufferBytes_ - b.used);
+        std::memcpy(b.data.get() + b.used, data, n);
+        b.used += n;
+        data += n;
+        len -= n;
+        if (b.used == bufferBytes_) {
+            SealCurrent();
+            wake_.notify_one();
+        }
+    }
+}
+
+void AsyncWriter::Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::uint64_t target = stats_.bytes;
+    sealNow_ = true;
+    wake_.notify_one();
+    freed_.wait(lock, [&] { return stats_.bytesWritten >= target; });
+}
+
+AsyncWriterStats AsyncWriter::Stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void AsyncWriter::SealCurrent() {
+    if (current_ < 0) return;
+    if (buffers_[(size_t)current_].used == 0) {
+        free_.push_back(current_);
+    } else {
+        queued_.push_back(current_);
+    }
+    current_ = -1;
+}
+
+void AsyncWriter::Run() {
+    std::vector<int> batch;
+    batch.reserve(buffers_.size());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        const bool woken = wake_.wait_for(lock, std::chrono::milliseconds(flushEveryMs_),
+            [this] { return quit_ || sealNow_ || !queued_.empty(); });
+
+        // Timed out, asked to flush or shutting down: the partial buffer goes too.
+        if (!woken || sealNow_ || quit_) SealCurrent();
+        sealNow_ = false;
+
+        if (queued_.empty()) {
+            if (quit_) break;
+            continue;
+        }
+
+        batch.swap(queued_);
+        stats_.maxQueued = std::max(stats_.maxQueued, (int)batch.size());
+        lock.unlock();
+
+        std::uint64_t written = 0;
+        std::uint64_t errors = 0;
+        for (int i : batch) {
+            const Buffer& b = buffers_[(size_t)i];
+            const std::size_t n = std::fwrite(b.data.get(), 1, b.used, out_);
+            if (n != b.used) errors++;
+            written += b.used;
+        }
+        std::fflush(out_);
+
+        lock.lock();
+        for (int i : batch) {
+            buffers_[(size_t)i].used = 0;
+            free_.push_back(i);
+        }
+        stats_.buffersWritten += batch.size();
+        stats_.bytesWritten += written;
+        stats_.batches++;
+        stats_.writeErrors += errors;
+        batch.clear();
+        freed_.notify_all();
+    }
+}
+
+} // namespace calibration
@@ -0,0 +1,86 @@
+#pragma once
+
+// Batched output for frame streams written from the ticking thread.
+//
+// A plain printf per frame is a write syscall (or a stdio lock and possibly a
+// syscall) on the timer path, and a slow consumer on the other end of a pipe
+// stalls the tick. AsyncWriter copies each record into one of a fixed set of
+// preallocated buffers; a full buffer is queued to the writer thread, which
+// writes every queued buffer and flushes once per batch, then hands the
+// buffers back. A partly filled buffer is queued after flushEveryMs, so output
+// lags by at most that much at low frame rates.
+//
+// Nothing is dropped: when every buffer is queued (the consumer is slower than
+// the producer) Append waits for the writer to return one. Such stalls are
+// counted with their total time, which is how back-pressure shows up in the
+// run summary.
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace calibration {
+
+struct AsyncWriterStats {
+    std::uint64_t appends = 0;
+    std::uint64_t bytes = 0;          // appended
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t buffersWritten = 0;
+    std::uint64_t batches = 0;        // flushes of the output stream
+    std::uint64_t stalls = 0;         // appends that waited for a free buffer
+    std::int64_t stallUs = 0;
+    int maxQueued = 0;                // most buffers handed over in one batch
+    std::uint64_t writeErrors = 0;    // short writes
+};
+
+class AsyncWriter {
+public:
+    // out stays owned by the caller and must outlive the writer.
+    explicit AsyncWriter(std::FILE* out, int buffers = 64, std::size_t bufferBytes = 16 * 1024,
+        int flushEveryMs = 50);
+    ~AsyncWriter(); // writes everything appended before returning
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    // Copies len bytes; a record larger than a buffer is split across buffers.
+    void Append(const char* data, std::size_t len);
+
+    // Returns once everything appended so far has been written and flushed.
+    void Flush();
+
+    AsyncWriterStats Stats() const;
+
+private:
+    struct Buffer {
+        std::unique_ptr<char[]> data;
+        std::size_t used = 0;
+    };
+
+    void Run();
+    void SealCurrent();  // mutex held
+
+    std::FILE* out_;
+    const std::size_t bufferBytes_;
+    const int flushEveryMs_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;   // writer: a buffer was queued, flush or quit
+    std::condition_variable freed_;  // producers: buffers came back
+    std::vector<Buffer> buffers_;
+    std::vector<int> free_;
+    std::vector<int> queued_;        // in append order
+    int current_ = -1;               // buffer being filled, -1 if none
+    bool sealNow_ = false;
+    bool quit_ = false;
+    AsyncWriterStats stats_;
+
+    std::thread thread_;
+};
+
+} // namespace calibration
@@ -0,0 +1,634 @@
+#include "calibration_engine.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "alloc_stats.h"
+#include "metrics.h"
+#include "trace.h"
+
+namespace calibration {
+
+namespace {
+
+wchar_t MaskToBrailleCell(unsigned char mask) {
+    return (wchar_t)(0x2800 + (wchar_t)mask);
+}
+
+bool IsColumnMajorMode(Mode m) {
+    return m == Mode::AllDots_ColumnMajor;
+}
+
+bool IsRandomMode(Mode m) {
+    return m == Mode::RandomGroupings;
+}
+
+bool IsDashCycleMode(Mode m) {
+    return m == Mode::DashesCycle_14_25_36_78;
+}
+
+bool IsAlternateMode(Mode m) {
+    return m == Mode::Alternate1237_4568;
+}
+
+unsigned char FixedMaskForMode(Mode m) {
+    switch (m) {
+    case Mode::AllDots_RowMajor:
+    case Mode::AllDots_ColumnMajor:
+        return 0xFF;
+
+    case Mode::Dots78:   return 0xC0;
+    case Mode::Dots1237: return 0x47;
+    case Mode::Dots4568: return 0xB8;
+
+    case Mode::Dots1346:  return 0x2D;
+    case Mode::Dots1256:  return 0x33;
+    case Mode::Dots1267:  return 0x63;
+    case Mode::Dots347:   return 0x4C;
+    case Mode::Dots12367: return 0x67;
+    case Mode::Dots12356: return 0x37;
+    case Mode::Dots3678:  return 0xE4;
+
+    default:
+        return 0x00;
+    }
+}
+
+// Running average with 1/8 weight for the newest sample.
+void UpdateEstimate(std::int64_t& estimate, std::int64_t sampleUs) {
+    if (sampleUs < 0) sampleUs = 0;
+    estimate += (sampleUs - estimate) / 8;
+}
+
+wchar_t DashCycleCell(int subStep) {
+    // Cycle: dots 1-4, 2-5, 3-6, 7-8
+    // bit 0..7 == dot 1..8
+    static const unsigned char masks[4] = {
+        0x09, // 1 + 4
+        0x12, // 2 + 5
+        0x24, // 3 + 6
+        0xC0  // 7 + 8
+    };
+    return MaskToBrailleCell(masks[subStep & 3]);
+}
+
+} // namespace
+
+std::wstring ModeLabel(Mode m) {
+    switch (m) {
+    case Mode::AllDots_RowMajor: return L"All dots (1-8), row-major walk";
+    case Mode::AllDots_ColumnMajor: return L"All dots (1-8), column-major walk";
+    case Mode::RandomGroupings: return L"Random dot groupings";
+    case Mode::DashesCycle_14_25_36_78: return L"Dashes cycle (1-4 / 2-5 / 3-6 / 7-8)";
+
+    case Mode::Dots78: return L"Dots 7-8";
+    case Mode::Dots1237: return L"Dots 1-2-3-7";
+    case Mode::Dots4568: return L"Dots 4-5-6-8";
+    case Mode::Alternate1237_4568: return L"Alternating 1237 / 4568";
+
+    case Mode::Dots1346: return L"Dots 1-3-4-6";
+    case Mode::Dots1256: return L"Dots 1-2-5-6";
+    case Mode::Dots1267: return L"Dots 1-2-6-7";
+    case Mode::Dots347:  return L"Dots 3-4-7";
+    case Mode::Dots12367:return L"Dots 1-2-3-6-7";
+    case Mode::Dots12356:return L"Dots 1-2-3-5-6";
+    case Mode::Dots3678: return L"Dots 3-6-7-8";
+    default: return L"(unknown)";
+    }
+}
+
+std::int64_t SteadyClock::NowUs() const {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+int StepToCellIndex(const Settings& settings, int stepIndex) {
+    if (!IsColumnMajorMode(settings.mode)) return stepIndex;
+
+    // Column-major order over a virtual grid:
+    // for col in 0..cols-1:
+    //   for row in 0..rows-1:
+    //      index = row*cols + col
+    int col = stepIndex / settings.rows;
+    int row = stepIndex % settings.rows;
+
+    if (col < 0) col = 0;
+    if (col >= settings.cols) col = settings.cols - 1;
+    if (row < 0) row = 0;
+    if (row >= settings.rows) row = settings.rows - 1;
+
+    return row * settings.cols + col;
+}
+
+int CellToStepIndex(const Settings& settings, int cellIndex) {
+    if (!IsColumnMajorMode(settings.mode)) return cellIndex;
+
+    // Inverse of StepToCellIndex.
+    const int col = cellIndex % settings.cols;
+    const int row = cellIndex / settings.cols;
+    return col * settings.rows + row;
+}
+
+void BuildPatternLine(const Settings& settings, bool phaseOn, int stepIndex, int dashSubStep,
+                      std::mt19937& rng, std::wstring& line) {
+    const int totalCells = settings.TotalCells();
+
+    // Reuses line's capacity, so the per-tick path does not allocate.
+    line.assign((size_t)std::max(totalCells, 0), kBrailleBlank);
+    if (totalCells <= 0) return;
+
+    // Random mode is special:
+    if (IsRandomMode(settings.mode)) {
+        // If "Blink whole line" is checked, we treat it literally:
+        // ON phase: every cell gets a random non-zero mask
+        // OFF phase: blank line
+        if (settings.wholeLine) {
+            if (!phaseOn) return;
+            std::uniform_int_distribution<int> dist(1, 255);
+            for (int i = 0; i < totalCells; ++i) {
+                unsigned char mask = (unsigned char)dist(rng);
+                line[(size_t)i] = MaskToBrailleCell(mask);
+            }
+            return;
+        }
+
+        // Otherwise, "groupings": sprinkle random patterns across the line, no forced blank phase.
+        std::uniform_real_distribution<double> chance(0.0, 1.0);
+        std::uniform_int_distribution<int> dist(1, 255);
+
+        const double fillProb = 0.35;
+        for (int i = 0; i < totalCells; ++i) {
+            if (chance(rng) <= fillProb) {
+                unsigned char mask = (unsigned char)dist(rng);
+                line[(size_t)i] = MaskToBrailleCell(mask);
+            }
+        }
+        return;
+    }
+
+    // Whole-line blink mode (applies to every non-random mode)
+    if (settings.wholeLine) {
+        if (!phaseOn) return;
+
+        if (IsDashCycleMode(settings.mode)) {
+            const wchar_t cell = DashCycleCell(dashSubStep);
+            std::fill(line.begin(), line.end(), cell);
+            return;
+        }
+
+        if (IsAlternateMode(settings.mode)) {
+            const wchar_t a = MaskToBrailleCell(0x47); // 1237
+            const wchar_t b = MaskToBrailleCell(0xB8); // 4568
+            for (size_t i = 0; i < line.size(); ++i) {
+                line[i] = (i % 2 == 0) ? a : b;
+            }
+            return;
+        }
+
+        // Fixed mask
+        unsigned char mask = FixedMaskForMode(settings.mode);
+        if (mask == 0x00) mask = 0xFF;
+        std::fill(line.begin(), line.end(), MaskToBrailleCell(mask));
+        return;
+    }
+
+    // Walking mode (default): one active cell blinks at a time.
+    const int cellIndex = StepToCellIndex(settings, stepIndex);
+    if (cellIndex < 0 || cellIndex >= totalCells) return;
+
+    if (!phaseOn) {
+        return; // OFF phase: blank line
+    }
+
+    if (IsDashCycleMode(settings.mode)) {
+        line[(size_t)cellIndex] = DashCycleCell(dashSubStep);
+        return;
+    }
+
+    if (IsAlternateMode(settings.mode)) {
+        // Alternate pattern based on *actual* cell index parity.
+        const unsigned char mask = ((cellIndex % 2) == 0) ? 0x47 : 0xB8;
+        line[(size_t)cellIndex] = MaskToBrailleCell(mask);
+        return;
+    }
+
+    unsigned char mask = FixedMaskForMode(settings.mode);
+    if (mask == 0x00) mask = 0xFF;
+    line[(size_t)cellIndex] = MaskToBrailleCell(mask);
+}
+
+Engine::Engine() = default;
+
+std::int64_t Engine::NowUs() const {
+    return clock_ ? clock_->NowUs() : 0;
+}
+
+std::wstring Engine::BuildBlankLine() const {
+    return std::wstring((size_t)totalCells_, kBrailleBlank);
+}
+
+MemoryUsage Engine::Memory() const {
+    MemoryUsage m;
+    m.engineBytes = sizeof(*this);
+    m.rngBytes = sizeof(rng_);
+
+    // Heap blocks only; short strings live inside the Engine object.
+    const std::wstring empty;
+    for (const std::wstring* s : { &lastFrame_, &preparedFrame_ }) {
+        if (s->capacity() > empty.capacity()) m.frameBufferBytes += (s->capacity() + 1) * sizeof(wchar_t);
+    }
+    return m;
+}
+
+void Engine::ReserveFrames(int cells) {
+    if (cells <= 0) return;
+    lastFrame_.reserve((size_t)cells);
+    preparedFrame_.reserve((size_t)cells);
+}
+
+void Engine::BuildBlankLine(std::wstring& out) const {
+    out.assign((size_t)totalCells_, kBrailleBlank);
+}
+
+int Engine::MapStepToCellIndex(int stepIndex) const {
+    return StepToCellIndex(settings_, stepIndex);
+}
+
+int Engine::MapCellToStepIndex(int cellIndex) const {
+    return CellToStepIndex(settings_, cellIndex);
+}
+
+std::wstring Engine::BuildLineForTick() {
+    std::wstring line;
+    BuildLineForTick(line);
+    return line;
+}
+
+void Engine::BuildLineForTick(std::wstring& line) {
+    BuildPatternLine(settings_, phaseOn_, stepIndex_, dashSubStep_, rng_, line);
+}
+
+void Engine::Publish(const std::wstring& line, bool force) {
+    // Same length + same cells == same frame; nothing for the screen reader to pick up.
+    if (!force && suppressRedundant_ && haveLastFrame_ && line == lastFrame_) {
+        stats_.framesSkipped++;
+        if (metrics_) metrics_->Add(metrics_->framesSkipped);
+        return;
+    }
+
+    const std::int64_t now = NowUs();
+    if (sink_) {
+        {
+            TraceSpan span("write");
+            sink_->WriteFrame(line, now);
+        }
+        const std::int64_t sinkUs = NowUs() - now;
+        UpdateEstimate(sinkCostUs_, sinkUs);
+        if (metrics_) metrics_->sinkLatency.Observe(sinkUs);
+    }
+
+    lastFrame_.assign(line);
+    haveLastFrame_ = true;
+    stats_.framesWritten++;
+    stats_.lastFrameUs = now;
+    if (metrics_) metrics_->Add(metrics_->framesWritten);
+}
+
+void Engine::Start(const Settings& settings, std::uint32_t seed) {
+    settings_ = settings;
+    totalCells_ = settings.TotalCells();
+
+    phaseOn_ = true;
+    stepIndex_ = 0;
+    dashSubStep_ = 0;
+    paused_ = false;
+    finishPending_ = false;
+    prepared_ = false;
+    settingsPending_ = false;
+
+    seed_ = seed;
+    rng_.seed(seed);
+
+    stats_ = Stats{};
+    stats_.startUs = NowUs();
+
+    // The first frame is an ON frame.
+    nextDelayMs_ = PhaseDurationMs(true);
+    nextTickUs_ = stats_.startUs + 1000LL * nextDelayMs_;
+
+    running_ = true;
+    UpdateMetricsState();
+
+    // First frame immediately, even if it matches what a previous session
+    // (e.g. a pooled engine's stop blank) left behind: the sink may be new.
+    haveLastFrame_ = false;
+    BuildLineForTick(preparedFrame_);
+    Publish(preparedFrame_);
+}
+
+EngineSnapshot Engine::Snapshot() const {
+    EngineSnapshot snap;
+    snap.settings = settings_;
+    snap.seed = seed_;
+    snap.settingsPending = settingsPending_;
+    if (settingsPending_) snap.pendingSettings = pendingSettings_;
+
+    snap.phaseOn = phaseOn_;
+    snap.stepIndex = stepIndex_;
+    snap.dashSubStep = dashSubStep_;
+    snap.finishPending = finishPending_;
+    snap.delayMs = nextDelayMs_;
+
+    snap.ticks = stats_.ticks;
+    snap.framesWritten = stats_.framesWritten;
+    snap.framesSkipped = stats_.framesSkipped;
+    snap.elapsedUs = NowUs() - stats_.startUs;
+
+    snap.rng = rng_;
+    snap.frame = lastFrame_;
+    return snap;
+}
+
+void Engine::Resume(const EngineSnapshot& snap) {
+    settings_ = snap.settings;
+    totalCells_ = settings_.TotalCells();
+
+    phaseOn_ = snap.phaseOn;
+    stepIndex_ = snap.stepIndex;
+    dashSubStep_ = snap.dashSubStep & 3;
+    finishPending_ = snap.finishPending;
+    paused_ = false;
+    prepared_ = false;
+
+    // Applied by the next PrepareTick/Tick, from the saved step.
+    settingsPending_ = snap.settingsPending;
+    pendingSettings_ = snap.pendingSettings;
+    pendingSettings_.cols = settings_.cols;
+    pendingSettings_.rows = settings_.rows;
+
+    seed_ = snap.seed;
+    rng_ = snap.rng;
+
+    stats_ = Stats{};
+    stats_.ticks = snap.ticks;
+    stats_.framesWritten = snap.framesWritten;
+    stats_.framesSkipped = snap.framesSkipped;
+    stats_.startUs = NowUs() - snap.elapsedUs;
+
+    nextDelayMs_ = snap.delayMs > 0 ? snap.delayMs : PhaseDurationMs(true);
+    nextTickUs_ = NowUs() + 1000LL * nextDelayMs_;
+
+    running_ = true;
+    UpdateMetricsState();
+
+    // Put the saved line back up; it gets a full phase before the next tick.
+    haveLastFrame_ = false;
+    if ((int)snap.frame.size() == totalCells_) {
+        Publish(snap.frame);
+    } else {
+        Publish(BuildBlankLine());
+    }
+}
+
+void Engine::Stop(std::int64_t requestedAtUs) {
+    if (!running_) return;
+
+    running_ = false;
+    paused_ = false;
+    finishPending_ = false;
+    prepared_ = false;
+
+    // Blank output (built in the frame buffer, which is free now)
+    BuildBlankLine(preparedFrame_);
+    Publish(preparedFrame_);
+    UpdateMetricsState();
+
+    if (requestedAtUs >= 0) {
+        stats_.stopLatencyUs = std::max<std::int64_t>(0, NowUs() - requestedAtUs);
+    }
+}
+
+std::int64_t Engine::NextTickUs() const {
+    return nextTickUs_;
+}
+
+void Engine::Reconfigure(const Settings& settings) {
+    if (!running_) return;
+
+    pendingSettings_ = settings;
+    pendingSettings_.cols = settings_.cols;
+    pendingSettings_.rows = settings_.rows;
+    settingsPending_ = true;
+
+    // A prepared frame was built with the old settings.
+    prepared_ = false;
+}
+
+void Engine::ApplyPendingSettings() {
+    if (!settingsPending_) return;
+    settingsPending_ = false;
+
+    // Remember which cell the walk is on, in the old traversal order.
+    const int cell = (stepIndex_ >= 0 && stepIndex_ < totalCells_) ? MapStepToCellIndex(stepIndex_) : -1;
+
+    settings_ = pendingSettings_;
+
+    if (cell >= 0) stepIndex_ = MapCellToStepIndex(cell);
+    if (!IsDashCycleMode(settings_.mode)) dashSubStep_ = 0;
+
+    // OFF phase dropped while blank: show the current cell again instead of a zero-length OFF.
+    if (!phaseOn_ && settings_.OffDurationMs() <= 0) phaseOn_ = true;
+
+    // Random groupings never blink and refresh every intervalMs; switched to
+    // during an OFF phase, nothing in AdvanceState would leave it.
+    if (IsRandomMode(settings_.mode) && !settings_.wholeLine) phaseOn_ = true;
+
+    // Loop switched back on during the final ON frame: wrap instead of finishing.
+    if (finishPending_ && settings_.loop) {
+        finishPending_ = false;
+        stepIndex_ = 0;
+    }
+}
+
+void Engine::Seek(int stepIndex) {
+    if (!running_) return;
+    ApplyPendingSettings();
+
+    stepIndex_ = std::max(0, std::min(stepIndex, totalCells_ - 1));
+    phaseOn_ = true;
+    dashSubStep_ = 0;
+    finishPending_ = false;
+    prepared_ = false;
+
+    nextDelayMs_ = PhaseDurationMs(true);
+    nextTickUs_ = NowUs() + 1000LL * nextDelayMs_;
+    UpdateMetricsState();
+
+    BuildLineForTick(preparedFrame_);
+    Publish(preparedFrame_);
+}
+
+void Engine::SetPaused(bool paused) {
+    if (paused == paused_) return;
+    paused_ = paused;
+
+    // A frame built before the pause reflects stale state.
+    prepared_ = false;
+
+    if (!paused && running_) {
+        nextTickUs_ = NowUs() + 1000LL * nextDelayMs_;
+    }
+}
+
+void Engine::BuildPreparedFrame() {
+    const std::int64_t t0 = NowUs();
+    {
+        TraceSpan span("generate");
+        BuildLineForTick(preparedFrame_);
+    }
+    preparedAtUs_ = NowUs();
+    UpdateEstimate(buildCostUs_, preparedAtUs_ - t0);
+    prepared_ = true;
+}
+
+void Engine::PrepareTick() {
+    if (!running_ || paused_ || prepared_) return;
+    AllocationScope allocs(stats_.tickAllocations, stats_.tickAllocatedBytes);
+    ApplyPendingSettings();
+    if (finishPending_) return;
+    BuildPreparedFrame();
+}
+
+void Engine::Tick() {
+    if (!running_ || paused_) return;
+    TraceSpan span("tick");
+    AllocationScope allocs(stats_.tickAllocations, stats_.tickAllocatedBytes);
+
+    stats_.ticks++;
+    ApplyPendingSettings();
+
+    const std::int64_t deadline = nextTickUs_;
+    const std::int64_t now = NowUs();
+    if (now > deadline) {
+        stats_.lateTicks++;
+        stats_.totalLateUs += now - deadline;
+        stats_.maxLateUs = std::max(stats_.maxLateUs, now - deadline);
+    }
+    if (metrics_) {
+        metrics_->Add(metrics_->ticks);
+        metrics_->tickLateness.Observe(now - deadline);
+        if (now > deadline) metrics_->Add(metrics_->lateTicks);
+    }
+
+    if (finishPending_) {
+        Stop();
+        return;
+    }
+
+    // The frame published now stays up for its phase's duration. Deadlines are
+    // absolute so timer jitter does not accumulate.
+    nextDelayMs_ = PhaseDurationMs(phaseOn_);
+    nextTickUs_ = deadline + 1000LL * nextDelayMs_;
+    bool resynced = false;
+    if (nextTickUs_ <= now) {
+        nextTickUs_ = now + 1000LL * nextDelayMs_;
+        stats_.resyncs++;
+        resynced = true;
+        if (metrics_) metrics_->Add(metrics_->framesDropped);
+    }
+
+    if (!prepared_) BuildPreparedFrame();
+    prepared_ = false;
+    const std::int64_t publishUs = NowUs();
+    stats_.maxStaleUs = std::max(stats_.maxStaleUs, publishUs - preparedAtUs_);
+
+    const std::uint64_t writtenBefore = stats_.framesWritten;
+    Publish(preparedFrame_);
+
+    if (observer_) {
+        TickInfo info;
+        info.deadlineUs = deadline;
+        info.lateUs = std::max<std::int64_t>(0, now - deadline);
+        info.staleUs = publishUs - preparedAtUs_;
+        info.resynced = resynced;
+        info.written = stats_.framesWritten != writtenBefore;
+        observer_->OnTick(info);
+    }
+
+    AdvanceState();
+    UpdateMetricsState();
+}
+
+void Engine::UpdateMetricsState() {
+    if (!metrics_) return;
+    metrics_->running.store(running_ ? 1 : 0, std::memory_order_relaxed);
+    metrics_->cells.store(totalCells_, std::memory_order_relaxed);
+    metrics_->progressCells.store(stepIndex_, std::memory_order_relaxed);
+}
+
+void Engine::FinishPass() {
+    if (metrics_) metrics_->Add(metrics_->passes);
+
+    // With an OFF phase the pass ends on an OFF tick, whose frame is already blank.
+    // Without one, the last ON frame was just published and gets its full duration.
+    if (settings_.OffDurationMs() > 0) {
+        Stop();
+    } else {
+        finishPending_ = true;
+    }
+}
+
+void Engine::AdvanceState() {
+    // Random groupings (non-whole-line) just keeps updating; no on/off stepping.
+    if (IsRandomMode(settings_.mode) && !settings_.wholeLine) return;
+
+    // For all other situations, we blink ON/OFF (unless the OFF phase is dropped).
+    if (phaseOn_ && settings_.OffDurationMs() > 0) {
+        phaseOn_ = false;
+        return;
+    }
+
+    // OFF -> ON, or ON -> ON without an OFF phase (this is where we advance the walk/cycle)
+    phaseOn_ = true;
+
+    if (settings_.wholeLine) {
+        // Whole-line: there is no walk. Only dashes has an internal cycle worth advancing.
+        if (IsDashCycleMode(settings_.mode)) {
+            dashSubStep_++;
+            if (dashSubStep_ >= 4) {
+                dashSubStep_ = 0;
+                if (!settings_.loop) {
+                    FinishPass();
+                }
+            }
+        } else {
+            // For whole-line blink, if loop is off, one blink cycle is enough.
+            if (!settings_.loop) {
+                FinishPass();
+            }
+        }
+        return;
+    }
+
+    // Walking mode: advance cell position (and dash substep if needed).
+    if (IsDashCycleMode(settings_.mode)) {
+        dashSubStep_++;
+        if (dashSubStep_ >= 4) {
+            dashSubStep_ = 0;
+            stepIndex_++;
+        }
+    } else {
+        stepIndex_++;
+    }
+
+    if (stepIndex_ >= totalCells_) {
+        if (settings_.loop) {
+            stepIndex_ = 0;
+            if (metrics_) metrics_->Add(metrics_->passes);
+        } else {
+            FinishPass();
+        }
+    }
+}
+
+} // namespace calibration
@@ -0,0 +1,325 @@
+#pragma once
+
+// Platform-independent calibration engine: pattern generation, the ON/OFF
+// stepping state machine and loop/stop logic. The Win32 dialog drives it from
+// WM_TIMER with a real clock; the simulator drives it with a virtual clock.
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace calibration {
+
+struct SessionMetrics;
+
+// Keep combo order == enum order.
+enum class Mode : int {
+    AllDots_RowMajor = 0,
+    AllDots_ColumnMajor = 1,
+    RandomGroupings = 2,
+    DashesCycle_14_25_36_78 = 3,
+
+    Dots78 = 4,
+    Dots1237 = 5,
+    Dots4568 = 6,
+    Alternate1237_4568 = 7,
+
+    Dots1346 = 8,   // mask 0x2D
+    Dots1256 = 9,   // mask 0x33
+    Dots1267 = 10,  // mask 0x63
+    Dots347  = 11,  // mask 0x4C
+    Dots12367 = 12, // mask 0x67
+    Dots12356 = 13, // mask 0x37
+    Dots3678  = 14  // mask 0xE4
+};
+
+constexpr int kModeCount = 15;
+
+constexpr wchar_t kBrailleBlank = 0x2800;
+
+std::wstring ModeLabel(Mode m);
+
+struct Settings {
+    int cols = 24;
+    int rows = 4;
+    int intervalMs = 500;   // ON phase (and the refresh period of random groupings)
+    int offMs = -1;         // OFF (blank) phase: -1 = same as intervalMs, 0 = no OFF phase
+    Mode mode = Mode::AllDots_RowMajor;
+    bool loop = true;
+    bool wholeLine = false;
+
+    int TotalCells() const { return cols * rows; } // single long line
+    int OffDurationMs() const { return offMs < 0 ? intervalMs : offMs; }
+};
+
+// Pattern logic shared by Engine and SessionBatch: the cell a walk step lights
+// (row- or column-major), and the frame for one stepping state. Random modes
+// draw from rng.
+int StepToCellIndex(const Settings& settings, int stepIndex);
+int CellToStepIndex(const Settings& settings, int cellIndex);
+void BuildPatternLine(const Settings& settings, bool phaseOn, int stepIndex, int dashSubStep,
+                      std::mt19937& rng, std::wstring& out);
+
+// Time source for frame timestamps and tick deadlines, in microseconds.
+class Clock {
+public:
+    virtual ~Clock() = default;
+    virtual std::int64_t NowUs() const = 0;
+};
+
+// Wall time (std::chrono::steady_clock).
+class SteadyClock : public Clock {
+public:
+    std::int64_t NowUs() const override;
+};
+
+// Manually advanced time. Lets a whole run execute as fast as the CPU allows
+// while producing the same frame/timestamp sequence as a real-time run.
+class VirtualClock : public Clock {
+public:
+    explicit VirtualClock(std::int64_t startUs = 0) : nowUs_(startUs) {}
+
+    std::int64_t NowUs() const override { return nowUs_; }
+    void AdvanceTo(std::int64_t us) { if (us > nowUs_) nowUs_ = us; }
+    void AdvanceBy(std::int64_t us) { if (us > 0) nowUs_ += us; }
+
+private:
+    std::int64_t nowUs_;
+};
+
+// Receives every frame the engine publishes (after redundant-frame suppression).
+class FrameSink {
+public:
+    virtual ~FrameSink() = default;
+    virtual void WriteFrame(const std::wstring& line, std::int64_t timeUs) = 0;
+};
+
+struct Stats {
+    std::uint64_t ticks = 0;          // timer ticks processed (excluding the first frame)
+    std::uint64_t framesWritten = 0;  // frames handed to the sink
+    std::uint64_t framesSkipped = 0;  // identical to the previous frame, not re-sent
+    std::int64_t startUs = 0;
+    std::int64_t lastFrameUs = 0;
+
+    // Deadline tracking (engine clock). Lateness = publish time - tick deadline;
+    // staleness = publish time - time the frame was built.
+    std::uint64_t lateTicks = 0;
+    std::int64_t maxLateUs = 0;
+    std::int64_t totalLateUs = 0;
+    std::int64_t maxStaleUs = 0;
+    std::uint64_t resyncs = 0;        // fell a whole period behind; schedule rebased to now
+
+    // Stop request (key press) -> blank line on the sink, or -1 if the pass ended by itself.
+    std::int64_t stopLatencyUs = -1;
+
+    // Heap allocations made inside PrepareTick()/Tick() (sink included). Only
+    // counted when the counting operator new is linked in (see alloc_stats.h).
+    std::uint64_t tickAllocations = 0;
+    std::uint64_t tickAllocatedBytes = 0;
+};
+
+// Bytes held by one engine (session).
+struct MemoryUsage {
+    std::size_t engineBytes = 0;       // the Engine object itself, RNG state included
+    std::size_t rngBytes = 0;          // of which the Mersenne Twister state
+    std::size_t frameBufferBytes = 0;  // heap capacity of the last/prepared frame buffers
+
+    std::size_t TotalBytes() const { return engineBytes + frameBufferBytes; }
+};
+
+// Per-tick timing, reported after the frame has been published.
+struct TickInfo {
+    std::int64_t deadlineUs = 0;
+    std::int64_t lateUs = 0;          // publish start - deadline, 0 if on time
+    std::int64_t staleUs = 0;         // publish start - frame build time
+    bool resynced = false;
+    bool written = false;             // false if skipped as redundant
+};
+
+// Optional hook for monitors (soak runs). Called on the ticking thread, after
+// the frame is out, so it never delays the display; keep it cheap anyway.
+class TickObserver {
+public:
+    virtual ~TickObserver() = default;
+    virtual void OnTick(const TickInfo& info) = 0;
+};
+
+// Everything needed to continue a run at the exact tick it was taken at.
+struct EngineSnapshot {
+    Settings settings;                // active settings
+    std::uint32_t seed = 0;
+
+    // A Reconfigure not applied yet; Resume applies it at the next tick like
+    // the live run would (keeping the cell across a traversal switch).
+    bool settingsPending = false;
+    Settings pendingSettings;
+
+    const Settings& LatestSettings() const { return settingsPending ? pendingSettings : settings; }
+
+    bool phaseOn = true;
+    int stepIndex = 0;
+    int dashSubStep = 0;
+    bool finishPending = false;
+    int delayMs = 0;                  // duration of the frame on display
+
+    std::uint64_t ticks = 0;
+    std::uint64_t framesWritten = 0;
+    std::uint64_t framesSkipped = 0;
+    std::int64_t elapsedUs = 0;
+
+    std::mt19937 rng;                 // random modes continue the same sequence
+    std::wstring frame;               // line on display when the snapshot was taken
+};
+
+class Engine {
+public:
+    Engine();
+
+    void SetClock(const Clock* clock) { clock_ = clock; }
+    void SetSink(FrameSink* sink) { sink_ = sink; }
+    void SetTickObserver(TickObserver* observer) { observer_ = observer; }
+
+    // Live counters for metrics export; updated with relaxed atomics only.
+    void SetMetrics(SessionMetrics* metrics) { metrics_ = metrics; }
+
+    // Identical frames are skipped at the sink boundary unless this is off.
+    void SetSuppressRedundantFrames(bool on) { suppressRedundant_ = on; }
+
+    // Resets the walk and publishes the first frame immediately.
+    void Start(const Settings& settings, std::uint32_t seed);
+
+    // Late frame binding: a scheduler wakes at NextWakeUs(), calls PrepareTick()
+    // to build the next frame from the current state, then calls Tick() at the
+    // deadline. Pausing drops a prepared frame, so live controls apply to the
+    // very next one.
+    void PrepareTick();
+
+    // One timer tick: publish the frame for the current state (prepared or built
+    // now), then advance. May finish the run (loop off), in which case the blank
+    // line is published.
+    void Tick();
+
+    // Checkpointing: capture the running state between ticks, and continue a run
+    // from such a snapshot. Resume re-publishes the saved line and continues at
+    // the saved tick directly (no replay); the following frames are exactly the
+    // ones the original run would have produced.
+    EngineSnapshot Snapshot() const;
+    void Resume(const EngineSnapshot& snapshot);
+
+    // Publishes the blank line and ends the run. No-op when not running.
+    // requestedAtUs (engine clock) is when the operator asked for the stop; the
+    // time from then to the blank line is recorded as stopLatencyUs.
+    void Stop(std::int64_t requestedAtUs = -1);
+
+    // Live change of timing, mode/traversal, loop or whole-line while running.
+    // Geometry is kept. Applied at the next tick boundary (before the next frame
+    // is built) with the position preserved: the walk continues from the same
+    // cell, even when switching between row- and column-major order.
+    void Reconfigure(const Settings& settings);
+
+    // Jumps the walk to stepIndex (clamped to the line) and publishes its ON
+    // frame at once; the frame gets a full ON phase. Works while paused, and
+    // a run in its final frame carries on from the new position.
+    void Seek(int stepIndex);
+
+    // Resuming rebases the schedule so the paused time is not "caught up".
+    void SetPaused(bool paused);
+    bool Paused() const { return paused_; }
+    bool Running() const { return running_; }
+
+    // Scheduler: absolute deadline of the next tick on the engine clock, and the
+    // time until then measured from the last tick (ON or OFF duration of the
+    // frame now on the display).
+    std::int64_t NextTickUs() const;
+    int NextDelayMs() const { return nextDelayMs_; }
+
+    // Deadline minus the estimated build + sink cost (running averages) and a margin.
+    std::int64_t NextWakeUs() const { return nextTickUs_ - EstimatedLeadUs(); }
+    std::int64_t EstimatedLeadUs() const { return buildCostUs_ + sinkCostUs_ + leadMarginUs_; }
+    void SetLeadMarginUs(std::int64_t us) { leadMarginUs_ = us; }
+
+    const Settings& GetSettings() const { return settings_; }
+    const Stats& GetStats() const { return stats_; }
+    std::uint32_t Seed() const { return seed_; }
+
+    // Pass is over but the last ON frame is still up (no OFF phase); the next tick stops.
+    bool Finishing() const { return finishPending_; }
+
+    bool PhaseOn() const { return phaseOn_; }
+    int StepIndex() const { return stepIndex_; }
+    int DashSubStep() const { return dashSubStep_; }
+
+    std::wstring BuildBlankLine() const;
+    std::wstring BuildLineForTick();
+
+    // Same, into an existing buffer (no allocation once it has the capacity).
+    void BuildBlankLine(std::wstring& out) const;
+    void BuildLineForTick(std::wstring& out);
+
+    MemoryUsage Memory() const;
+
+    // Pre-sizes the frame buffers so starting a run of up to `cells` cells
+    // does not allocate (pooled sessions).
+    void ReserveFrames(int cells);
+
+    // Publishes a frame through the redundant-frame check. force re-sends even if unchanged.
+    void Publish(const std::wstring& line, bool force = false);
+
+private:
+    void AdvanceState();
+    void FinishPass();
+    void UpdateMetricsState();
+    void ApplyPendingSettings();
+    int MapCellToStepIndex(int cellIndex) const;
+    int MapStepToCellIndex(int stepIndex) const;
+    std::int64_t NowUs() const;
+    void BuildPreparedFrame();
+    int PhaseDurationMs(bool on) const { return on ? settings_.intervalMs : settings_.OffDurationMs(); }
+
+    Settings settings_;
+    int totalCells_ = 96;
+
+    Settings pendingSettings_;
+    bool settingsPending_ = false;
+
+    bool running_ = false;
+    bool paused_ = false;
+    bool finishPending_ = false;
+
+    // Animation state
+    bool phaseOn_ = true;   // ON -> OFF -> advance
+    int stepIndex_ = 0;     // 0..totalCells-1
+    int dashSubStep_ = 0;   // 0..3 for 1-4/2-5/3-6/7-8 cycle
+
+    std::uint32_t seed_ = 0;
+
+    // Last frame handed to the sink. Identical frames are skipped, since every
+    // write makes the screen reader re-fetch and re-translate the line.
+    std::wstring lastFrame_;
+    bool haveLastFrame_ = false;
+    bool suppressRedundant_ = true;
+
+    std::int64_t nextTickUs_ = 0;
+    int nextDelayMs_ = 0;
+
+    // Late binding: frame built ahead of the deadline, and cost estimates.
+    std::wstring preparedFrame_;
+    bool prepared_ = false;
+    std::int64_t preparedAtUs_ = 0;
+    std::int64_t buildCostUs_ = 0;
+    std::int64_t sinkCostUs_ = 0;
+    std::int64_t leadMarginUs_ = 200;
+    Stats stats_;
+
+    const Clock* clock_ = nullptr;
+    FrameSink* sink_ = nullptr;
+    TickObserver* observer_ = nullptr;
+    SessionMetrics* metrics_ = nullptr;
+
+    // Cold: 5 KB of generator state, only touched by random modes. Kept last so
+    // the fields every tick reads share the first cache lines.
+    std::mt19937 rng_;
+};
+
+} // namespace calibration
@@ -0,0 +1,306 @@
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace calibration {
+
+namespace {
+
+constexpr const char* kHeader = "BrailleCalibrationCheckpoint 1";
+
+// Frames are stored as 4 hex digits per cell so the file is plain ASCII.
+std::string EncodeLine(const std::wstring& line) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    out.reserve(line.size() * 4);
+    for (wchar_t wc : line) {
+        const unsigned c = (unsigned)wc & 0xFFFF;
+        out += digits[(c >> 12) & 0xF];
+        out += digits[(c >> 8) & 0xF];
+        out += digits[(c >> 4) & 0xF];
+        out += digits[c & 0xF];
+    }
+    return out;
+}
+
+bool DecodeLine(const std::string& hex, std::wstring& out) {
+    if (hex.size() % 4) return false;
+    out.clear();
+    out.reserve(hex.size() / 4);
+    for (size_t i = 0; i < hex.size(); i += 4) {
+        char* end = nullptr;
+        const std::string cell = hex.substr(i, 4);
+        const unsigned long c = std::strtoul(cell.c_str(), &end, 16);
+        if (end != cell.c_str() + 4) return false;
+        out += (wchar_t)c;
+    }
+    return true;
+}
+
+bool ParseInt64(const std::string& s, long long& out) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    out = std::strtoll(s.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+bool ParseUint64(const std::string& s, unsigned long long& out) {
+    if (s.empty() || s[0] == '-') return false;
+    char* end = nullptr;
+    out = std::strtoull(s.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+std::FILE* OpenFile(const std::filesystem::path& path, bool write) {
+#ifdef _WIN32
+    return _wfopen(path.c_str(), write ? L"wb" : L"rb");
+#else
+    return std::fopen(path.c_str(), write ? "wb" : "rb");
+#endif
+}
+
+bool FlushToDisk(std::FILE* f) {
+    if (std::fflush(f) != 0) return false;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+} // namespace
+
+std::string SerializeCheckpoint(const EngineSnapshot& snap) {
+    const Settings& s = snap.settings;
+    std::ostringstream out;
+    out << kHeader << '\n'
+        << "cols=" << s.cols << '\n'
+        << "rows=" << s.rows << '\n'
+        << "intervalMs=" << s.intervalMs << '\n'
+        << "offMs=" << s.offMs << '\n'
+        << "mode=" << (int)s.mode << '\n'
+        << "loop=" << (s.loop ? 1 : 0) << '\n'
+        << "wholeLine=" << (s.wholeLine ? 1 : 0) << '\n'
+        << "seed=" << snap.seed << '\n'
+        << "phaseOn=" << (snap.phaseOn ? 1 : 0) << '\n'
+        << "stepIndex=" << snap.stepIndex << '\n'
+        << "dashSubStep=" << snap.dashSubStep << '\n'
+        << "finishPending=" << (snap.finishPending ? 1 : 0) << '\n'
+        << "delayMs=" << snap.delayMs << '\n'
+        << "ticks=" << snap.ticks << '\n'
+        << "framesWritten=" << snap.framesWritten << '\n'
+        << "framesSkipped=" << snap.framesSkipped << '\n'
+        << "elapsedUs=" << snap.elapsedUs << '\n'
+        << "rng=" << snap.rng << '\n'
+        << "frame=" << EncodeLine(snap.frame) << '\n';
+    if (snap.settingsPending) {
+        const Settings& p = snap.pendingSettings;
+        out << "pendingIntervalMs=" << p.intervalMs << '\n'
+            << "pendingOffMs=" << p.offMs << '\n'
+            << "pendingMode=" << (int)p.mode << '\n'
+            << "pendingLoop=" << (p.loop ? 1 : 0) << '\n'
+            << "pendingWholeLine=" << (p.wholeLine ? 1 : 0) << '\n';
+    }
+    out << "end\n";
+    return out.str();
+}
+
+bool ParseCheckpoint(const std::string& text, EngineSnapshot& out) {
+    std::istringstream in(text);
+    std::string line;
+    if (!std::getline(in, line) || line != kHeader) return false;
+
+    EngineSnapshot snap;
+    Settings& s = snap.settings;
+    Settings& p = snap.pendingSettings;
+    bool haveRng = false;
+    bool complete = false;
+
+    while (std::getline(in, line)) {
+        if (line == "end") {
+            complete = true;
+            break;
+        }
+
+        const size_t eq = line.find('=');
+        if (eq == std::string::npos) return false;
+        const std::string key = line.substr(0, eq);
+        const std::string value = line.substr(eq + 1);
+
+        if (key == "rng") {
+            std::istringstream rngIn(value);
+            rngIn >> snap.rng;
+            if (rngIn.fail()) return false;
+            haveRng = true;
+            continue;
+        }
+        if (key == "frame") {
+            if (!DecodeLine(value, snap.frame)) return false;
+            continue;
+        }
+
+        long long v = 0;
+        unsigned long long u = 0;
+        if (key == "ticks" || key == "framesWritten" || key == "framesSkipped") {
+            if (!ParseUint64(value, u)) return false;
+        } else if (!ParseInt64(value, v)) {
+            return false;
+        }
+
+        if (key == "cols") s.cols = (int)v;
+        else if (key == "rows") s.rows = (int)v;
+        else if (key == "intervalMs") s.intervalMs = (int)v;
+        else if (key == "offMs") s.offMs = (int)v;
+        else if (key == "mode") s.mode = (Mode)v;
+        else if (key == "loop") s.loop = (v != 0);
+        else if (key == "wholeLine") s.wholeLine = (v != 0);
+        else if (key == "seed") snap.seed = (std::uint32_t)v;
+        else if (key == "phaseOn") snap.phaseOn = (v != 0);
+        else if (key == "stepIndex") snap.stepIndex = (int)v;
+        else if (key == "dashSubStep") snap.dashSubStep = (int)v;
+        else if (key == "finishPending") snap.finishPending = (v != 0);
+        else if (key == "delayMs") snap.delayMs = (int)v;
+        else if (key == "ticks") snap.ticks = u;
+        else if (key == "framesWritten") snap.framesWritten = u;
+        else if (key == "framesSkipped") snap.framesSkipped = u;
+        else if (key == "elapsedUs") snap.elapsedUs = v;
+        else if (key.compare(0, 7, "pending") == 0) {
+            snap.settingsPending = true;
+            if (key == "pendingIntervalMs") p.intervalMs = (int)v;
+            else if (key == "pendingOffMs") p.offMs = (int)v;
+            else if (key == "pendingMode") p.mode = (Mode)v;
+            else if (key == "pendingLoop") p.loop = (v != 0);
+            else if (key == "pendingWholeLine") p.wholeLine = (v != 0);
+        }
+        // Unknown keys are ignored so newer files still load.
+    }
+
+    if (!complete || !haveRng) return false;
+
+    // Same limits as the dialog accepts.
+    if (s.cols < 1 || s.rows < 1 || 1LL * s.cols * s.rows > 5000) return false;
+    if (s.intervalMs < 1 || s.offMs < -1) return false;
+    if ((int)s.mode < 0 || (int)s.mode >= kModeCount) return false;
+    if (snap.settingsPending) {
+        p.cols = s.cols;
+        p.rows = s.rows;
+        if (p.intervalMs < 1 || p.offMs < -1) return false;
+        if ((int)p.mode < 0 || (int)p.mode >= kModeCount) return false;
+    }
+    if (snap.stepIndex < 0 || snap.stepIndex >= s.TotalCells()) return false;
+    if (snap.dashSubStep < 0 || snap.dashSubStep > 3) return false;
+    if (snap.elapsedUs < 0) return false;
+    if (!snap.frame.empty() && (int)snap.frame.size() != s.TotalCells()) return false;
+
+    out = std::move(snap);
+    return true;
+}
+
+bool WriteFileAtomic(const std::filesystem::path& path, const std::string& data) {
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+
+    std::FILE* f = OpenFile(tmp, true);
+    if (!f) return false;
+    const bool written = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    const bool flushed = written && FlushToDisk(f);
+    const bool closed = std::fclose(f) == 0;
+
+    std::error_code ec;
+    if (!(written && flushed && closed)) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+
+    // Replaces an existing checkpoint in one step on both platforms.
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool LoadCheckpoint(const std::filesystem::path& path, EngineSnapshot& out) {
+    std::FILE* f = OpenFile(path, false);
+    if (!f) return false;
+
+    std::string text;
+    char buf[4096];
+    size_t n = 0;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) {
+        text.append(buf, n);
+        if (text.size() > (1u << 20)) break; // not a checkpoint
+    }
+    std::fclose(f);
+
+    return ParseCheckpoint(text, out);
+}
+
+CheckpointWriter::CheckpointWriter(std::filesystem::path path)
+    : path_(std::move(path)), thread_([this] { Run(); }) {}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void CheckpointWriter::Submit(const EngineSnapshot& snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = snapshot;
+        havePending_ = true;
+    }
+    wake_.notify_one();
+}
+
+void CheckpointWriter::Clear() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        havePending_ = false;
+        clearPending_ = true;
+    }
+    wake_.notify_one();
+}
+
+void CheckpointWriter::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this] { return quit_ || havePending_ || clearPending_; });
+
+        // A clear queued before a newer snapshot is applied first.
+        if (clearPending_) {
+            clearPending_ = false;
+            lock.unlock();
+            std::error_code ec;
+            std::filesystem::remove(path_, ec);
+            lock.lock();
+        }
+
+        if (havePending_) {
+            EngineSnapshot snap = std::move(pending_);
+            havePending_ = false;
+            lock.unlock();
+            WriteFileAtomic(path_, SerializeCheckpoint(snap));
+            lock.lock();
+            continue;
+        }
+
+        if (quit_) break;
+    }
+}
+
+} // namespace calibration
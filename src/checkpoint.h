@@ -0,0 +1,61 @@
+#pragma once
+
+// Checkpoint/resume for long calibration runs.
+//
+// A checkpoint is a small key=value text file holding an EngineSnapshot
+// (settings, seed, stepping state, counters, RNG state and the line on
+// display). Files are replaced atomically (write temp, flush to disk, rename),
+// so a crash leaves either the previous or the new checkpoint, never a torn one.
+// CheckpointWriter does the serialization and file I/O on its own thread;
+// callers on the timer path only copy the snapshot.
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+std::string SerializeCheckpoint(const EngineSnapshot& snapshot);
+
+// Returns false for anything that is not a complete, in-range checkpoint.
+bool ParseCheckpoint(const std::string& text, EngineSnapshot& out);
+
+bool WriteFileAtomic(const std::filesystem::path& path, const std::string& data);
+bool LoadCheckpoint(const std::filesystem::path& path, EngineSnapshot& out);
+
+class CheckpointWriter {
+public:
+    explicit CheckpointWriter(std::filesystem::path path);
+    ~CheckpointWriter(); // writes a still-pending snapshot before returning
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Queues a snapshot; a newer one replaces a snapshot not yet written.
+    void Submit(const EngineSnapshot& snapshot);
+
+    // Drops any queued snapshot and deletes the file (run ended normally).
+    void Clear();
+
+    const std::filesystem::path& Path() const { return path_; }
+
+private:
+    void Run();
+
+    std::filesystem::path path_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    EngineSnapshot pending_;
+    bool havePending_ = false;
+    bool clearPending_ = false;
+    bool quit_ = false;
+
+    std::thread thread_;
+};
+
+} // namespace calibration
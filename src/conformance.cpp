@@ -0,0 +1,415 @@
+#include "conformance.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+
+#include "session_pool.h"
+#include "work_stealing.h"
+
+namespace calibration {
+
+namespace {
+
+struct GoldenEntry {
+    int mode;
+    int wholeLine;
+    int loop;
+    int cols;
+    int rows;
+    std::uint64_t hash;
+};
+
+const GoldenEntry kGolden[] = {
+#include "conformance_golden.inc"
+};
+
+// Ticks per case. Enough to wrap the largest geometry several times with the
+// dash cycle (4 sub-steps x 2 phases per cell).
+constexpr int kTicksPerCase = 10000;
+
+const int kGeometries[][2] = {
+    { 1, 1 }, { 1, 7 }, { 7, 1 }, { 3, 2 }, { 24, 4 }, { 40, 1 }, { 30, 10 },
+};
+
+// Frozen copy of the pre-engine BuildLineForTick/AdvanceState logic (main.cpp
+// as of the engine extraction). Do not change this when optimizing the engine:
+// it is the oracle the engine is compared against.
+class ReferenceModel {
+public:
+    ReferenceModel(const Settings& s, std::uint32_t seed)
+        : s_(s), totalCells_(s.TotalCells()), rng_(seed) {}
+
+    bool running = true;
+    bool phaseOn = true;
+    int stepIndex = 0;
+    int dashSubStep = 0;
+
+    std::wstring BuildBlankLine() const {
+        return std::wstring((size_t)totalCells_, kBrailleBlank);
+    }
+
+    std::wstring BuildLineForTick() {
+        std::wstring line = BuildBlankLine();
+        if (totalCells_ <= 0) return line;
+
+        if (s_.mode == Mode::RandomGroupings) {
+            if (s_.wholeLine) {
+                if (!phaseOn) return line;
+                std::uniform_int_distribution<int> dist(1, 255);
+                for (int i = 0; i < totalCells_; ++i) {
+                    line[(size_t)i] = Cell((unsigned char)dist(rng_));
+                }
+                return line;
+            }
+
+            std::uniform_real_distribution<double> chance(0.0, 1.0);
+            std::uniform_int_distribution<int> dist(1, 255);
+            for (int i = 0; i < totalCells_; ++i) {
+                if (chance(rng_) <= 0.35) {
+                    line[(size_t)i] = Cell((unsigned char)dist(rng_));
+                }
+            }
+            return line;
+        }
+
+        if (s_.wholeLine) {
+            if (!phaseOn) return line;
+
+            if (s_.mode == Mode::DashesCycle_14_25_36_78) {
+                std::fill(line.begin(), line.end(), DashCell(dashSubStep));
+                return line;
+            }
+            if (s_.mode == Mode::Alternate1237_4568) {
+                for (size_t i = 0; i < line.size(); ++i) {
+                    line[i] = (i % 2 == 0) ? Cell(0x47) : Cell(0xB8);
+                }
+                return line;
+            }
+            unsigned char mask = FixedMask(s_.mode);
+            if (mask == 0x00) mask = 0xFF;
+            std::fill(line.begin(), line.end(), Cell(mask));
+            return line;
+        }
+
+        int cellIndex = stepIndex;
+        if (s_.mode == Mode::AllDots_ColumnMajor) {
+            int col = stepIndex / s_.rows;
+            int row = stepIndex % s_.rows;
+            if (col < 0) col = 0;
+            if (col >= s_.cols) col = s_.cols - 1;
+            if (row < 0) row = 0;
+            if (row >= s_.rows) row = s_.rows - 1;
+            cellIndex = row * s_.cols + col;
+        }
+        if (cellIndex < 0 || cellIndex >= totalCells_) return line;
+        if (!phaseOn) return line;
+
+        if (s_.mode == Mode::DashesCycle_14_25_36_78) {
+            line[(size_t)cellIndex] = DashCell(dashSubStep);
+            return line;
+        }
+        if (s_.mode == Mode::Alternate1237_4568) {
+            line[(size_t)cellIndex] = ((cellIndex % 2) == 0) ? Cell(0x47) : Cell(0xB8);
+            return line;
+        }
+        unsigned char mask = FixedMask(s_.mode);
+        if (mask == 0x00) mask = 0xFF;
+        line[(size_t)cellIndex] = Cell(mask);
+        return line;
+    }
+
+    void AdvanceState() {
+        if (s_.mode == Mode::RandomGroupings && !s_.wholeLine) return;
+
+        if (phaseOn) {
+            phaseOn = false;
+            return;
+        }
+        phaseOn = true;
+
+        const bool dash = (s_.mode == Mode::DashesCycle_14_25_36_78);
+        if (s_.wholeLine) {
+            if (dash) {
+                dashSubStep++;
+                if (dashSubStep >= 4) {
+                    dashSubStep = 0;
+                    if (!s_.loop) running = false;
+                }
+            } else if (!s_.loop) {
+                running = false;
+            }
+            return;
+        }
+
+        if (dash) {
+            dashSubStep++;
+            if (dashSubStep >= 4) {
+                dashSubStep = 0;
+                stepIndex++;
+            }
+        } else {
+            stepIndex++;
+        }
+
+        if (stepIndex >= totalCells_) {
+            if (s_.loop) stepIndex = 0;
+            else running = false;
+        }
+    }
+
+private:
+    static wchar_t Cell(unsigned char mask) { return (wchar_t)(0x2800 + mask); }
+
+    static wchar_t DashCell(int subStep) {
+        static const unsigned char masks[4] = { 0x09, 0x12, 0x24, 0xC0 };
+        return Cell(masks[subStep & 3]);
+    }
+
+    static unsigned char FixedMask(Mode m) {
+        switch (m) {
+        case Mode::AllDots_RowMajor:
+        case Mode::AllDots_ColumnMajor: return 0xFF;
+        case Mode::Dots78:    return 0xC0;
+        case Mode::Dots1237:  return 0x47;
+        case Mode::Dots4568:  return 0xB8;
+        case Mode::Dots1346:  return 0x2D;
+        case Mode::Dots1256:  return 0x33;
+        case Mode::Dots1267:  return 0x63;
+        case Mode::Dots347:   return 0x4C;
+        case Mode::Dots12367: return 0x67;
+        case Mode::Dots12356: return 0x37;
+        case Mode::Dots3678:  return 0xE4;
+        default: return 0x00;
+        }
+    }
+
+    Settings s_;
+    int totalCells_;
+    std::mt19937 rng_;
+};
+
+constexpr std::uint32_t kSeed = 12345;
+
+struct Frame {
+    std::wstring line;
+    std::int64_t timeUs;
+};
+
+// Either hashes frames or records them for a side-by-side diff.
+class StreamSink : public FrameSink {
+public:
+    explicit StreamSink(std::vector<Frame>* record = nullptr) : record_(record) {}
+
+    void WriteFrame(const std::wstring& line, std::int64_t timeUs) override {
+        hash.AddFrame(line, timeUs);
+        frames++;
+        if (record_) record_->push_back(Frame{ line, timeUs });
+    }
+
+    FrameStreamHash hash;
+    std::uint64_t frames = 0;
+
+private:
+    std::vector<Frame>* record_;
+};
+
+// Engine under test: first frame, then one frame per tick, then the stop blank.
+void RunEngine(const ConformanceCase& c, StreamSink& sink, SessionPool& pool) {
+    VirtualClock clock;
+    PooledSession engine(pool, c.settings.TotalCells());
+    engine->SetClock(&clock);
+    engine->SetSink(&sink);
+    engine->SetSuppressRedundantFrames(false);
+
+    engine->Start(c.settings, kSeed);
+    for (int t = 0; t < c.ticks && engine->Running(); ++t) {
+        clock.AdvanceTo(engine->NextTickUs());
+        engine->Tick();
+    }
+    engine->Stop();
+}
+
+void RunReference(const ConformanceCase& c, StreamSink& sink) {
+    ReferenceModel ref(c.settings, kSeed);
+    const std::int64_t intervalUs = 1000LL * c.settings.intervalMs;
+
+    std::int64_t now = 0;
+    sink.WriteFrame(ref.BuildLineForTick(), now);
+    for (int t = 0; t < c.ticks && ref.running; ++t) {
+        now += intervalUs;
+        sink.WriteFrame(ref.BuildLineForTick(), now);
+        ref.AdvanceState();
+    }
+    sink.WriteFrame(ref.BuildBlankLine(), now);
+}
+
+const GoldenEntry* FindGolden(const Settings& s) {
+    for (const GoldenEntry& e : kGolden) {
+        if (e.mode == (int)s.mode && e.wholeLine == (int)s.wholeLine && e.loop == (int)s.loop &&
+            e.cols == s.cols && e.rows == s.rows) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+void PrintCase(std::FILE* out, const Settings& s) {
+    std::fprintf(out, "mode=%d wholeLine=%d loop=%d geometry=%dx%d",
+        (int)s.mode, (int)s.wholeLine, (int)s.loop, s.cols, s.rows);
+}
+
+// Replays engine and reference and reports the first differing frame/cell.
+void ReportFirstDifference(std::FILE* out, const ConformanceCase& c) {
+    std::vector<Frame> got, want;
+    StreamSink gotSink(&got), wantSink(&want);
+    SessionPool pool;
+    RunEngine(c, gotSink, pool);
+    RunReference(c, wantSink);
+
+    const size_t n = std::min(got.size(), want.size());
+    for (size_t i = 0; i < n; ++i) {
+        const Frame& a = got[i];
+        const Frame& b = want[i];
+        if (a.timeUs != b.timeUs) {
+            std::fprintf(out, "    first difference at tick %zu: time %lld us, expected %lld us\n",
+                i, (long long)a.timeUs, (long long)b.timeUs);
+            return;
+        }
+        if (a.line.size() != b.line.size()) {
+            std::fprintf(out, "    first difference at tick %zu: %zu cells, expected %zu\n",
+                i, a.line.size(), b.line.size());
+            return;
+        }
+        for (size_t cell = 0; cell < a.line.size(); ++cell) {
+            if (a.line[cell] != b.line[cell]) {
+                std::fprintf(out, "    first difference at tick %zu, cell %zu: mask 0x%02X, expected 0x%02X\n",
+                    i, cell, (unsigned)(a.line[cell] - kBrailleBlank), (unsigned)(b.line[cell] - kBrailleBlank));
+                return;
+            }
+        }
+    }
+
+    if (got.size() != want.size()) {
+        std::fprintf(out, "    stream length differs: %zu frames, expected %zu\n", got.size(), want.size());
+    } else {
+        std::fprintf(out, "    engine matches the reference model; the golden hash is stale\n");
+    }
+}
+
+} // namespace
+
+void FrameStreamHash::AddFrame(const std::wstring& line, std::int64_t timeUs) {
+    Mix((std::uint64_t)timeUs);
+    Mix((std::uint64_t)line.size());
+
+    // Four 16-bit cells per 64-bit word.
+    const size_t n = line.size();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        Mix((std::uint64_t)(std::uint16_t)line[i] |
+            ((std::uint64_t)(std::uint16_t)line[i + 1] << 16) |
+            ((std::uint64_t)(std::uint16_t)line[i + 2] << 32) |
+            ((std::uint64_t)(std::uint16_t)line[i + 3] << 48));
+    }
+    std::uint64_t tail = 0;
+    for (int shift = 0; i < n; ++i, shift += 16) {
+        tail |= (std::uint64_t)(std::uint16_t)line[i] << shift;
+    }
+    Mix(tail);
+}
+
+std::vector<ConformanceCase> ConformanceCases() {
+    std::vector<ConformanceCase> cases;
+    for (int mode = 0; mode < kModeCount; ++mode) {
+        for (int wholeLine = 0; wholeLine <= 1; ++wholeLine) {
+            for (int loop = 0; loop <= 1; ++loop) {
+                for (const auto& geo : kGeometries) {
+                    ConformanceCase c;
+                    c.settings.mode = (Mode)mode;
+                    c.settings.wholeLine = (wholeLine != 0);
+                    c.settings.loop = (loop != 0);
+                    c.settings.cols = geo[0];
+                    c.settings.rows = geo[1];
+                    c.settings.intervalMs = 500;
+                    c.ticks = kTicksPerCase;
+                    cases.push_back(c);
+                }
+            }
+        }
+    }
+    return cases;
+}
+
+ConformanceReport RunConformance(std::FILE* out, int workers) {
+    ConformanceReport report;
+    const std::vector<ConformanceCase> cases = ConformanceCases();
+
+    // Cases are independent; each worker recycles engines through its own pool.
+    struct CaseResult {
+        std::uint64_t engineHash = 0;
+        std::uint64_t referenceHash = 0;
+        std::uint64_t frames = 0;
+    };
+    std::vector<CaseResult> results(cases.size());
+    WorkStealingPool executor(workers);
+    std::deque<SessionPool> pools((size_t)executor.Workers());
+
+    executor.Run((int)cases.size(), [&](int i, int worker) {
+        StreamSink engineSink, refSink;
+        RunEngine(cases[(size_t)i], engineSink, pools[(size_t)worker]);
+        RunReference(cases[(size_t)i], refSink);
+        results[(size_t)i] = CaseResult{ engineSink.hash.Value(), refSink.hash.Value(), engineSink.frames };
+    });
+
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const ConformanceCase& c = cases[i];
+        const CaseResult& r = results[i];
+
+        report.cases++;
+        report.frames += r.frames;
+
+        bool ok = (r.engineHash == r.referenceHash);
+
+        // Random modes depend on the standard library's distributions, so they
+        // are only checked against the reference model, not a stored hash.
+        if (const GoldenEntry* golden = FindGolden(c.settings)) {
+            report.goldenChecked++;
+            if (golden->hash != r.engineHash) ok = false;
+        }
+
+        if (!ok) {
+            report.failed++;
+            std::fprintf(out, "MISMATCH ");
+            PrintCase(out, c.settings);
+            std::fprintf(out, "\n");
+            ReportFirstDifference(out, c);
+        }
+    }
+
+    for (const SessionPool& pool : pools) {
+        report.sessionsCreated += pool.Stats().created;
+        report.sessionsReused += pool.Stats().reused;
+    }
+    report.workers = executor.Workers();
+    report.steals = 0;
+    for (int w = 0; w < executor.Workers(); ++w) report.steals += executor.Stats(w).steals;
+    return report;
+}
+
+void PrintConformanceGolden(std::FILE* out) {
+    std::fprintf(out, "// Generated by BrailleCalibrationSim --conformance-update. Do not edit by hand.\n");
+    std::fprintf(out, "// mode, wholeLine, loop, cols, rows, frame-stream hash (reference model)\n");
+
+    for (const ConformanceCase& c : ConformanceCases()) {
+        if (c.settings.mode == Mode::RandomGroupings) continue;
+
+        StreamSink sink;
+        RunReference(c, sink);
+        std::fprintf(out, "{ %d, %d, %d, %d, %d, 0x%016llXULL },\n",
+            (int)c.settings.mode, (int)c.settings.wholeLine, (int)c.settings.loop,
+            c.settings.cols, c.settings.rows, (unsigned long long)sink.hash.Value());
+    }
+}
+
+} // namespace calibration
@@ -0,0 +1,64 @@
+#pragma once
+
+// Golden frame-stream conformance suite.
+//
+// Every mode / whole-line / loop / geometry combination is run for a fixed
+// number of ticks on a virtual clock. Each frame stream is hashed and checked
+// against the stored golden hashes (conformance_golden.inc) and against a
+// frozen reference copy of the original BuildLineForTick/AdvanceState logic.
+// On a mismatch the two streams are replayed side by side to report the first
+// differing tick and cell.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+// Fast non-cryptographic 64-bit hash over a frame stream. Cells are hashed as
+// 16-bit values so the result does not depend on sizeof(wchar_t).
+class FrameStreamHash {
+public:
+    void AddFrame(const std::wstring& line, std::int64_t timeUs);
+    std::uint64_t Value() const { return h_; }
+
+private:
+    void Mix(std::uint64_t v) {
+        h_ ^= v;
+        h_ *= 0x9E3779B97F4A7C15ULL;
+        h_ ^= h_ >> 29;
+    }
+
+    std::uint64_t h_ = 0xCBF29CE484222325ULL;
+};
+
+struct ConformanceCase {
+    Settings settings;
+    int ticks = 0;
+};
+
+// All combinations covered by the suite, in a stable order.
+std::vector<ConformanceCase> ConformanceCases();
+
+struct ConformanceReport {
+    int cases = 0;
+    int failed = 0;
+    int goldenChecked = 0;     // cases that also had a stored golden hash
+    std::uint64_t frames = 0;
+    std::uint64_t sessionsCreated = 0;  // engines constructed by the session pool
+    std::uint64_t sessionsReused = 0;   // cases served by a recycled engine
+    int workers = 1;
+    std::uint64_t steals = 0;           // cases run by a worker they were not dealt to
+};
+
+// Runs the suite on `workers` threads (<= 0: one per hardware thread), printing
+// one line per failing case to out in case order.
+ConformanceReport RunConformance(std::FILE* out, int workers = 1);
+
+// Prints a fresh golden table (the contents of conformance_golden.inc).
+void PrintConformanceGolden(std::FILE* out);
+
+} // namespace calibration
@@ -0,0 +1,128 @@
+#include "diff_bench.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+
+#include "calibration_engine.h"
+#include "frame_diff.h"
+
+namespace calibration {
+
+namespace {
+
+constexpr int kCheckPairs = 20000;
+constexpr int kMaxReportedMismatches = 20;
+constexpr int kBenchGap = 2;
+
+wchar_t RandomCell(std::mt19937& rng) {
+    return (wchar_t)(kBrailleBlank + (rng() & 0xFF));
+}
+
+// Random prev/next pairs: lengths around the 16-cell block edges and up to a
+// large display, change densities from none to every cell.
+int CheckAgainstScalar(std::FILE* out, int& pairs) {
+    static const double kDensity[] = { 0.0, 0.001, 0.01, 0.1, 0.5, 0.9, 1.0 };
+    std::mt19937 rng(12345);
+    std::vector<CellSpan> fast, reference;
+    std::wstring prev, next;
+    int mismatches = 0;
+
+    for (pairs = 0; pairs < kCheckPairs; ++pairs) {
+        const int cells = pairs < 200 ? pairs % 100 : (int)(rng() % 5001);
+        const double density = kDensity[pairs % 7];
+        const int gap = (pairs / 7) % 5;
+        std::bernoulli_distribution change(density);
+
+        prev.resize((size_t)cells);
+        for (wchar_t& c : prev) c = (rng() & 1) ? kBrailleBlank : RandomCell(rng);
+        next = prev;
+        for (wchar_t& c : next) {
+            if (change(rng)) c = (wchar_t)(c ^ (1 + (rng() & 0x7F)));
+        }
+
+        DiffFrames(prev.data(), next.data(), cells, gap, fast);
+        DiffFramesScalar(prev.data(), next.data(), cells, gap, reference);
+        bool same = fast.size() == reference.size();
+        for (size_t i = 0; same && i < fast.size(); ++i) {
+            same = fast[i].begin == reference[i].begin && fast[i].end == reference[i].end;
+        }
+        if (!same && mismatches++ < kMaxReportedMismatches && out) {
+            std::fprintf(out, "diff check: %d cells, gap %d, density %.3f: %zu spans, scalar %zu\n",
+                cells, gap, density, fast.size(), reference.size());
+        }
+    }
+    return mismatches;
+}
+
+using DiffFn = int (*)(const wchar_t*, const wchar_t*, int, int, std::vector<CellSpan>&);
+
+// Also counts a mismatch unless every call found expectedSpans spans; using
+// the result keeps the calls from being dropped.
+double MeasureGBs(DiffFn fn, const std::wstring& prev, const std::wstring& next, double seconds,
+                  std::vector<CellSpan>& spans, int expectedSpans, int& mismatches) {
+    const int cells = (int)prev.size();
+    std::uint64_t rounds = 0;
+    std::uint64_t total = 0;
+    const auto start = std::chrono::steady_clock::now();
+    double elapsed = 0.0;
+    do {
+        for (int k = 0; k < 256; ++k) total += (std::uint64_t)fn(prev.data(), next.data(), cells, kBenchGap, spans);
+        rounds += 256;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < seconds);
+
+    if (total != rounds * (std::uint64_t)expectedSpans) mismatches++;
+    return elapsed > 0 ? rounds * 2.0 * cells * sizeof(wchar_t) / elapsed / 1e9 : 0.0;
+}
+
+} // namespace
+
+DiffBenchReport RunDiffBenchmark(double secondsPerVariant, std::FILE* out) {
+    DiffBenchReport report;
+    report.mismatches = CheckAgainstScalar(out, report.pairsChecked);
+
+    Settings s;
+    s.cols = 80;
+    s.rows = 25;
+    const int cells = s.TotalCells();
+    std::mt19937 rng(1);
+
+    std::wstring blank((size_t)cells, kBrailleBlank);
+    std::wstring walk = blank;
+    walk[1000] = (wchar_t)(kBrailleBlank + 0xFF);
+    std::wstring walkNext = blank;
+    walkNext[1001] = (wchar_t)(kBrailleBlank + 0xFF);
+
+    s.mode = Mode::RandomGroupings;
+    std::wstring random, randomNext;
+    BuildPatternLine(s, true, 0, 0, rng, random);
+    BuildPatternLine(s, true, 0, 0, rng, randomNext);
+
+    struct Variant {
+        const char* name;
+        const std::wstring* prev;
+        const std::wstring* next;
+    };
+    const Variant variants[] = {
+        { "unchanged frame", &blank, &blank },
+        { "walking step", &walk, &walkNext },
+        { "random groupings", &random, &randomNext },
+    };
+
+    std::vector<CellSpan> spans;
+    spans.reserve((size_t)cells);
+    for (const Variant& v : variants) {
+        DiffBenchResult r;
+        r.name = v.name;
+        r.spans = DiffFrames(v.prev->data(), v.next->data(), cells, kBenchGap, spans);
+        r.scalarGBs = MeasureGBs(DiffFramesScalar, *v.prev, *v.next, secondsPerVariant, spans,
+            r.spans, report.mismatches);
+        r.simdGBs = MeasureGBs(DiffFrames, *v.prev, *v.next, secondsPerVariant, spans,
+            r.spans, report.mismatches);
+        report.results.push_back(r);
+    }
+    return report;
+}
+
+} // namespace calibration
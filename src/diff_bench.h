@@ -0,0 +1,29 @@
+#pragma once
+
+// Frame differ check and throughput: DiffFrames against the scalar reference
+// on random frame pairs (sizes, change densities and merge gaps), then the
+// rate of both on 80 x 25 frames for an unchanged frame, a walking step and
+// two random-grouping frames.
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace calibration {
+
+struct DiffBenchResult {
+    const char* name = "";
+    int spans = 0;              // dirty spans per frame (merge gap 2)
+    double scalarGBs = 0.0;     // frame bytes compared per second, both frames
+    double simdGBs = 0.0;
+};
+
+struct DiffBenchReport {
+    int pairsChecked = 0;
+    int mismatches = 0;
+    std::vector<DiffBenchResult> results;
+};
+
+DiffBenchReport RunDiffBenchmark(double secondsPerVariant, std::FILE* out);
+
+} // namespace calibration
@@ -0,0 +1,394 @@
+#include "e2e_bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "scheduler.h"
+#include "terminal_view.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace calibration {
+
+namespace {
+
+constexpr char kMarkerPrefix[] = "e2e;";
+constexpr int kReadChunk = 1 << 16;
+
+// Pipe between the encoder and the display, raw file descriptors.
+bool OpenPipe(int fds[2]) {
+#ifdef _WIN32
+    return _pipe(fds, kReadChunk, _O_BINARY) == 0;
+#else
+    return pipe(fds) == 0;
+#endif
+}
+
+void CloseFd(int fd) {
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+
+long ReadFd(int fd, char* buf, int size) {
+#ifdef _WIN32
+    return _read(fd, buf, (unsigned)size);
+#else
+    return (long)read(fd, buf, (size_t)size);
+#endif
+}
+
+bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        const long n = _write(fd, data, (unsigned)size);
+#else
+        const long n = (long)write(fd, data, size);
+#endif
+        if (n <= 0) return false;
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+std::uint64_t HashCells(const wchar_t* cells, size_t count) {
+    std::uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < count; ++i) {
+        h ^= (std::uint64_t)(std::uint32_t)cells[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Stage boundaries of one published frame; -1 = not reached. The runner
+// writes the first group, the display the second; nothing is read until both
+// threads are done.
+struct FrameRecord {
+    std::int64_t wakeUs = -1;
+    std::int64_t builtUs = -1;
+    std::int64_t deadlineUs = -1;     // -1: start/stop frame, not a tick
+    std::int64_t sinkUs = -1;
+    std::int64_t encodedUs = -1;
+    std::int64_t writtenUs = -1;
+    std::uint64_t frameHash = 0;
+
+    std::int64_t shownUs = -1;
+    std::uint64_t shownHash = 0;
+};
+
+// Stand-in display: a VT100 subset (cursor position, UTF-8 cells) on a cell
+// grid, fed from the pipe. An OSC "e2e;<seq>" marker ends frame seq.
+class DisplayEmulator {
+public:
+    DisplayEmulator(const Clock& clock, int fd, int cols, int rows, std::vector<FrameRecord>& records)
+        : clock_(clock), fd_(fd), cols_(cols), rows_(rows), records_(records) {
+        grid_.assign((size_t)cols * rows, kBrailleBlank);
+        osc_.reserve(32);
+    }
+
+    // Until the write end is closed.
+    void Run() {
+        std::vector<char> buf((size_t)kReadChunk);
+        for (;;) {
+            const long n = ReadFd(fd_, buf.data(), kReadChunk);
+            if (n <= 0) break;
+            for (long i = 0; i < n; ++i) Feed((unsigned char)buf[(size_t)i]);
+        }
+    }
+
+private:
+    enum class State { Ground, Escape, Csi, Osc };
+
+    void Feed(unsigned char b) {
+        switch (state_) {
+        case State::Ground:
+            if (b == 0x1B) {
+                state_ = State::Escape;
+            } else if (b < 0x80) {
+                Put(b);
+            } else if ((b & 0xC0) == 0x80) {
+                if (pending_ > 0) {
+                    codepoint_ = (codepoint_ << 6) | (b & 0x3F);
+                    if (--pending_ == 0) Put(codepoint_);
+                }
+            } else if ((b & 0xE0) == 0xC0) {
+                codepoint_ = b & 0x1F;
+                pending_ = 1;
+            } else if ((b & 0xF0) == 0xE0) {
+                codepoint_ = b & 0x0F;
+                pending_ = 2;
+            }
+            break;
+
+        case State::Escape:
+            if (b == '[') {
+                params_[0] = params_[1] = 0;
+                param_ = 0;
+                state_ = State::Csi;
+            } else if (b == ']') {
+                osc_.clear();
+                state_ = State::Osc;
+            } else {
+                state_ = State::Ground;
+            }
+            break;
+
+        case State::Csi:
+            if (b >= '0' && b <= '9') {
+                if (param_ < 2) params_[param_] = params_[param_] * 10 + (b - '0');
+            } else if (b == ';') {
+                param_++;
+            } else if (b >= 0x40 && b <= 0x7E) {
+                if (b == 'H') {
+                    const int row = std::max(params_[0], 1) - 1;
+                    const int col = std::max(params_[1], 1) - 1;
+                    cursor_ = row * cols_ + col;
+                }
+                state_ = State::Ground;
+            }
+            break;
+
+        case State::Osc:
+            if (b == 0x07) {
+                EndOfFrame();
+                state_ = State::Ground;
+            } else if (osc_.size() < 32) {
+                osc_ += (char)b;
+            }
+            break;
+        }
+    }
+
+    void Put(std::uint32_t cell) {
+        if (cursor_ >= 0 && cursor_ < cols_ * rows_) grid_[(size_t)cursor_] = (wchar_t)cell;
+        cursor_++;
+    }
+
+    void EndOfFrame() {
+        const size_t prefix = sizeof(kMarkerPrefix) - 1;
+        if (osc_.compare(0, prefix, kMarkerPrefix) != 0) return;
+        const unsigned long long seq = std::strtoull(osc_.c_str() + prefix, nullptr, 10);
+        if (seq >= records_.size()) return;
+        FrameRecord& r = records_[(size_t)seq];
+        r.shownUs = clock_.NowUs();
+        r.shownHash = HashCells(grid_.data(), grid_.size());
+    }
+
+    const Clock& clock_;
+    int fd_;
+    int cols_;
+    int rows_;
+    std::vector<FrameRecord>& records_;
+
+    std::wstring grid_;
+    int cursor_ = 0;
+    State state_ = State::Ground;
+    std::uint32_t codepoint_ = 0;
+    int pending_ = 0;
+    int params_[2] = { 0, 0 };
+    int param_ = 0;
+    std::string osc_;
+};
+
+// Encodes each published frame for the display and writes it to the pipe.
+class PipelineSink : public FrameSink {
+public:
+    PipelineSink(const Clock& clock, int fd, const Settings& s, std::vector<FrameRecord>& records)
+        : clock_(clock), fd_(fd), records_(records) {
+        view_.Reset(s.cols, s.rows, 1, 1);
+        out_.reserve((size_t)s.TotalCells() * 3 + 64);
+    }
+
+    // Runner: stage times of the tick about to publish; cleared after it.
+    void SetTick(std::int64_t wakeUs, std::int64_t builtUs, std::int64_t deadlineUs) {
+        wakeUs_ = wakeUs;
+        builtUs_ = builtUs;
+        deadlineUs_ = deadlineUs;
+    }
+    void ClearTick() { deadlineUs_ = -1; }
+
+    void WriteFrame(const std::wstring& line, std::int64_t timeUs) override {
+        out_.clear();
+        view_.Render(line, out_);
+        char marker[48];
+        const int n = std::snprintf(marker, sizeof(marker), "\x1b]%s%llu\x07", kMarkerPrefix,
+            (unsigned long long)seq_);
+        out_.append(marker, (size_t)n);
+        const std::int64_t encodedUs = clock_.NowUs();
+        // A failed write shows up as frames that were never shown.
+        WriteAll(fd_, out_.data(), out_.size());
+        const std::int64_t writtenUs = clock_.NowUs();
+        bytes_ += out_.size();
+
+        if (seq_ < records_.size()) {
+            FrameRecord& r = records_[(size_t)seq_];
+            r.wakeUs = wakeUs_;
+            r.builtUs = builtUs_;
+            r.deadlineUs = deadlineUs_;
+            r.sinkUs = timeUs;
+            r.encodedUs = encodedUs;
+            r.writtenUs = writtenUs;
+            r.frameHash = HashCells(line.data(), line.size());
+        }
+        seq_++;
+    }
+
+    std::uint64_t Frames() const { return seq_; }
+    std::uint64_t Bytes() const { return bytes_; }
+
+private:
+    const Clock& clock_;
+    int fd_;
+    std::vector<FrameRecord>& records_;
+    TerminalView view_;
+    std::string out_;
+    std::uint64_t seq_ = 0;
+    std::uint64_t bytes_ = 0;
+
+    std::int64_t wakeUs_ = -1;
+    std::int64_t builtUs_ = -1;
+    std::int64_t deadlineUs_ = -1;
+};
+
+// Nearest-rank percentiles over the sorted samples.
+E2EStage Summarize(const char* name, std::vector<std::int64_t>& samples) {
+    E2EStage stage;
+    stage.name = name;
+    if (samples.empty()) return stage;
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+    auto at = [&](double p) {
+        const size_t rank = (size_t)(p * (double)n + 0.999999);
+        return samples[std::min(n, std::max<size_t>(rank, 1)) - 1];
+    };
+    double sum = 0.0;
+    for (std::int64_t v : samples) sum += (double)v;
+    stage.meanUs = sum / (double)n;
+    stage.p50Us = at(0.50);
+    stage.p90Us = at(0.90);
+    stage.p99Us = at(0.99);
+    stage.p999Us = at(0.999);
+    stage.maxUs = samples.back();
+    return stage;
+}
+
+E2ECase RunCase(const Settings& settings, double seconds, const RealTimeConfig* rt, RealTimeStatus& rtStatus) {
+    E2ECase result;
+    result.settings = settings;
+
+    // One record per tick (ON and OFF frames) plus the start and stop frames.
+    std::vector<FrameRecord> records((size_t)(seconds * 1000.0 / settings.intervalMs) + 64);
+
+    int fds[2];
+    if (!OpenPipe(fds)) return result;
+
+    SteadyClock clock;
+    PipelineSink sink(clock, fds[1], settings, records);
+    DisplayEmulator display(clock, fds[0], settings.cols, settings.rows, records);
+    std::thread displayThread([&] { display.Run(); });
+
+    Engine engine;
+    engine.SetClock(&clock);
+    engine.SetSink(&sink);
+    engine.ReserveFrames(settings.TotalCells());
+    engine.Start(settings, 1);
+    if (rt) rtStatus = EnterRealTime(*rt);
+
+    // Same wake/build/publish sequence as RunRealTime, stamped between the steps.
+    const std::int64_t endUs = engine.GetStats().startUs + (std::int64_t)(seconds * 1e6);
+    while (engine.Running() && engine.NextTickUs() <= endUs) {
+        SleepUntilUs(clock, engine.NextWakeUs());
+        const std::int64_t wakeUs = clock.NowUs();
+        engine.PrepareTick();
+        const std::int64_t builtUs = clock.NowUs();
+        const std::int64_t deadlineUs = engine.NextTickUs();
+        SleepUntilUs(clock, deadlineUs);
+        sink.SetTick(wakeUs, builtUs, deadlineUs);
+        engine.Tick();
+        sink.ClearTick();
+    }
+
+    if (rt) LeaveRealTime(rtStatus);
+    engine.Stop();
+    CloseFd(fds[1]);
+    displayThread.join();
+    CloseFd(fds[0]);
+
+    enum { Generate, Lead, Dispatch, Encode, Write, Transport, Total, StageCount };
+    static const char* const kNames[StageCount] = {
+        "generate", "lead", "dispatch", "encode", "write", "transport", "total"
+    };
+    std::vector<std::int64_t> samples[StageCount];
+    const size_t published = std::min<size_t>((size_t)sink.Frames(), records.size());
+    for (size_t i = 0; i < published; ++i) {
+        const FrameRecord& r = records[i];
+        if (r.shownUs >= 0 && r.shownHash != r.frameHash) result.mismatches++;
+        if (r.deadlineUs < 0) continue;
+        result.frames++;
+        if (r.shownUs < 0) {
+            result.missing++;
+            continue;
+        }
+        samples[Generate].push_back(r.builtUs - r.wakeUs);
+        samples[Lead].push_back(r.deadlineUs - r.builtUs);
+        samples[Dispatch].push_back(r.sinkUs - r.deadlineUs);
+        samples[Encode].push_back(r.encodedUs - r.sinkUs);
+        samples[Write].push_back(r.writtenUs - r.encodedUs);
+        samples[Transport].push_back(r.shownUs - r.encodedUs);
+        samples[Total].push_back(r.shownUs - r.deadlineUs);
+    }
+    for (int k = 0; k < StageCount; ++k) result.stages.push_back(Summarize(kNames[k], samples[k]));
+    result.bytes = sink.Bytes();
+    return result;
+}
+
+} // namespace
+
+E2EReport RunEndToEndBenchmark(double secondsPerCase, const RealTimeConfig* rt) {
+    struct Pattern {
+        const char* name;
+        Mode mode;
+        bool wholeLine;
+    };
+    static const Pattern kPatterns[] = {
+        { "row-major walk", Mode::AllDots_RowMajor, false },
+        { "column-major walk", Mode::AllDots_ColumnMajor, false },
+        { "random groupings", Mode::RandomGroupings, false },
+        { "whole line", Mode::AllDots_RowMajor, true },
+    };
+    static const int kGeometries[][2] = { { 40, 1 }, { 80, 1 }, { 80, 25 } };
+    static const int kIntervalsMs[] = { 1, 10 };
+
+    E2EReport report;
+    report.secondsPerCase = secondsPerCase;
+    for (const Pattern& p : kPatterns) {
+        for (const auto& g : kGeometries) {
+            for (int interval : kIntervalsMs) {
+                Settings s;
+                s.mode = p.mode;
+                s.wholeLine = p.wholeLine;
+                s.cols = g[0];
+                s.rows = g[1];
+                s.intervalMs = interval;
+                s.loop = true;
+                report.cases.push_back(RunCase(s, secondsPerCase, rt, report.rt));
+                report.cases.back().pattern = p.name;
+            }
+        }
+    }
+    return report;
+}
+
+} // namespace calibration
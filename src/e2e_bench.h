@@ -0,0 +1,64 @@
+#pragma once
+
+// End-to-end frame latency: how long a commanded frame takes to show up.
+//
+// Each case runs the real pipeline on the wall clock -- the runner's
+// wake/build/publish sequence, the engine's generator, the terminal encoder
+// (TerminalView: diff, cursor moves, UTF-8) -- and writes the frames into a
+// pipe. The display is a stand-in: a thread that reads the pipe, applies the
+// escape sequences to its own cell grid like a VT100 would, and stamps each
+// frame when its end marker arrives. Every frame is timestamped at each stage
+// boundary:
+//
+//   wake -> built          generate   (PrepareTick)
+//   built -> deadline      lead       (late binding margin, not latency)
+//   deadline -> sink       dispatch   (scheduler lateness)
+//   sink -> encoded        encode
+//   encoded -> write done  write      (the write call, seen by the runner)
+//   encoded -> shown       transport  (pipe + display parse)
+//   deadline -> shown      total
+//
+// The display also hashes its grid at every marker; a frame whose hash differs
+// from the one the engine published is a mismatch (the encoder or the
+// emulator lost a cell). Cases cover modes, geometries and intervals.
+
+#include <cstdint>
+#include <vector>
+
+#include "calibration_engine.h"
+#include "rt_thread.h"
+
+namespace calibration {
+
+// Exact distribution of one stage over a case (microseconds).
+struct E2EStage {
+    const char* name = "";
+    double meanUs = 0.0;
+    std::int64_t p50Us = 0;
+    std::int64_t p90Us = 0;
+    std::int64_t p99Us = 0;
+    std::int64_t p999Us = 0;
+    std::int64_t maxUs = 0;
+};
+
+struct E2ECase {
+    const char* pattern = "";         // "row-major walk", "whole line", ...
+    Settings settings;
+    std::uint64_t frames = 0;         // tick frames timed end to end
+    std::uint64_t missing = 0;        // published but never shown
+    std::uint64_t mismatches = 0;     // shown grid differs from the published frame
+    std::uint64_t bytes = 0;          // encoded bytes written to the display
+    std::vector<E2EStage> stages;
+};
+
+struct E2EReport {
+    double secondsPerCase = 0.0;
+    std::vector<E2ECase> cases;
+    RealTimeStatus rt;                // of the last case, when a real-time config was given
+};
+
+// Runs every case for secondsPerCase. rt (optional): the runner enters
+// real-time mode for each case.
+E2EReport RunEndToEndBenchmark(double secondsPerCase, const RealTimeConfig* rt);
+
+} // namespace calibration
@@ -0,0 +1,496 @@
+#include "explorer.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "calibration_engine.h"
+#include "checkpoint.h"
+#include "session_batch.h"
+#include "session_pool.h"
+#include "timer_wheel.h"
+
+namespace calibration {
+
+namespace {
+
+constexpr int kMaxReportedViolations = 50;
+constexpr std::uint32_t kTimerWheelSeeds = 200;
+constexpr int kPooledSessions = 200;
+
+// Checks every published frame against the phase it was built in.
+class CheckingSink : public FrameSink {
+public:
+    void Reset(int totalCells, bool wholeLine) {
+        totalCells_ = totalCells;
+        wholeLine_ = wholeLine;
+        seen_.assign((size_t)totalCells, 0);
+        seenCount = 0;
+        frames = 0;
+        lastFrameBlank = false;
+        badFrame = nullptr;
+    }
+
+    void WriteFrame(const std::wstring& line, std::int64_t) override {
+        frames++;
+
+        if ((int)line.size() != totalCells_) {
+            badFrame = "frame length differs from cols x rows";
+            return;
+        }
+
+        int lit = 0;
+        for (int i = 0; i < totalCells_; ++i) {
+            if (line[(size_t)i] == kBrailleBlank) continue;
+            lit++;
+            if (!seen_[(size_t)i]) {
+                seen_[(size_t)i] = 1;
+                seenCount++;
+            }
+        }
+        lastFrameBlank = (lit == 0);
+
+        if (!checkPhase) return;
+        if (!expectOn && lit != 0) badFrame = "OFF phase frame is not blank";
+        else if (expectOn && !wholeLine_ && lit != 1) badFrame = "walking ON frame does not light exactly one cell";
+        else if (expectOn && wholeLine_ && lit != totalCells_) badFrame = "whole-line ON frame leaves cells blank";
+    }
+
+    bool checkPhase = true;
+    bool expectOn = true;
+
+    int seenCount = 0;
+    std::uint64_t frames = 0;
+    bool lastFrameBlank = false;
+    const char* badFrame = nullptr;
+
+private:
+    int totalCells_ = 0;
+    bool wholeLine_ = false;
+    std::vector<unsigned char> seen_;
+};
+
+// Remembers the lit cell of the last frame (-1 if blank).
+class LitCellSink : public FrameSink {
+public:
+    void WriteFrame(const std::wstring& line, std::int64_t) override {
+        litCell = -1;
+        for (size_t i = 0; i < line.size(); ++i) {
+            if (line[i] != kBrailleBlank) {
+                litCell = (int)i;
+                break;
+            }
+        }
+    }
+
+    int litCell = -1;
+};
+
+// Live reconfiguration: switching traversal at any step must keep the walk on
+// the same cell (row-major -> column-major and back), also when the run is
+// checkpointed with the switch still pending and resumed from the file.
+const char* CheckTraversalSwitch(int cols, int rows, Engine& engine, LitCellSink& sink,
+                                 ExploreReport& report) {
+    const Mode orders[2] = { Mode::AllDots_RowMajor, Mode::AllDots_ColumnMajor };
+    const int cells = cols * rows;
+
+    for (int from = 0; from < 2; ++from) {
+        for (int target = 0; target < cells; ++target) {
+            Settings s;
+            s.cols = cols;
+            s.rows = rows;
+            s.intervalMs = 1;
+            s.mode = orders[from];
+
+            engine.Start(s, 1);
+            engine.Tick(); // first tick repeats the start frame
+            report.steps++;
+            while (engine.Running() && !(engine.StepIndex() == target && engine.PhaseOn())) {
+                engine.Tick();
+                report.steps++;
+            }
+            if (!engine.Running()) return "walk ended before reaching the switch point";
+
+            // Cell the next ON frame shows in the current order.
+            const int before = (from == 0) ? target : (target % rows) * cols + target / rows;
+
+            s.mode = orders[1 - from];
+            engine.Reconfigure(s);
+            EngineSnapshot snap;
+            if (!ParseCheckpoint(SerializeCheckpoint(engine.Snapshot()), snap)) {
+                return "checkpoint with a pending switch does not load";
+            }
+            engine.Tick();
+            report.steps++;
+
+            if (sink.litCell != before) return "traversal switch moved the walk to another cell";
+            engine.Stop();
+
+            engine.Resume(snap);
+            engine.Tick();
+            report.steps++;
+            if (sink.litCell != before) return "resumed traversal switch moved the walk to another cell";
+            engine.Stop();
+        }
+    }
+    return nullptr;
+}
+
+// Live switch to random groupings during an OFF phase: the groupings must then
+// refresh every intervalMs, not at the OFF time.
+const char* CheckRandomSwitch(Engine& engine, ExploreReport& report) {
+    Settings s;
+    s.cols = 4;
+    s.rows = 2;
+    s.intervalMs = 1;
+    s.offMs = 5;
+
+    engine.Start(s, 1);
+    engine.Tick(); // first tick repeats the start frame; the next frame is OFF
+    report.steps++;
+    if (engine.PhaseOn()) return "walk did not reach an OFF phase";
+
+    s.mode = Mode::RandomGroupings;
+    engine.Reconfigure(s);
+    for (int i = 0; i < 3; ++i) {
+        const std::int64_t before = engine.NextTickUs();
+        engine.Tick();
+        report.steps++;
+        if (engine.NextTickUs() - before != 1000LL * s.intervalMs) {
+            return "random groupings after a live switch do not refresh at the ON interval";
+        }
+    }
+    engine.Stop();
+    return nullptr;
+}
+
+// Counts published frames.
+class CountingSink : public FrameSink {
+public:
+    void WriteFrame(const std::wstring&, std::int64_t) override { frames++; }
+
+    std::uint64_t frames = 0;
+};
+
+// Pooled reuse with redundant-frame suppression on: every session must deliver
+// its first frame to its own sink, whatever the previous session on the same
+// engine left on the line. 1x1 random groupings start blank half the time.
+const char* CheckPooledReuse(ExploreReport& report) {
+    VirtualClock clock;
+    SessionPool pool;
+    const Mode modes[2] = { Mode::RandomGroupings, Mode::AllDots_RowMajor };
+
+    for (int i = 0; i < kPooledSessions; ++i) {
+        Settings s;
+        s.cols = 1 + (i / 2) % 2;
+        s.rows = 1;
+        s.intervalMs = 1;
+        s.mode = modes[i % 2];
+
+        CountingSink sink;
+        PooledSession engine(pool, s.TotalCells());
+        engine->SetClock(&clock);
+        engine->SetSink(&sink);
+        engine->Start(s, (std::uint32_t)i + 1);
+        if (sink.frames != 1 || engine->GetStats().framesSkipped != 0) {
+            return "reused session did not deliver its first frame";
+        }
+        for (int t = 0; t < 3; ++t) {
+            clock.AdvanceTo(engine->NextTickUs());
+            engine->Tick();
+            report.steps++;
+        }
+    }
+    return nullptr;
+}
+
+// Random schedule / cancel / expire sequences on a TimerWheel against a plain
+// per-timer reference. Deadlines and time steps span every wheel level and the
+// overflow list, so slot arithmetic and cascades are all exercised.
+const char* CheckTimerWheel(std::uint32_t seed, ExploreReport& report) {
+    constexpr int kTimers = 64;
+    constexpr int kOps = 4000;
+    const std::int64_t startUs = 1000;
+    const std::int64_t resUs = 250;
+
+    std::mt19937 rng(seed);
+    TimerWheel wheel(startUs, resUs);
+    std::vector<std::int64_t> expiry((size_t)kTimers, -1);  // reference, in ticks; -1 = disarmed
+    std::int64_t tick = 0;                                   // reference: next slot to expire
+    std::int64_t nowUs = startUs;
+
+    // Offsets up to 2^34 resolutions: past every level, into the overflow list.
+    auto span = [&]() {
+        const int bits = (int)(rng() % 35);
+        return (std::int64_t)(((std::uint64_t)rng() << 32 | rng()) & ((1ULL << bits) - 1));
+    };
+
+    std::vector<int> due;
+    std::vector<std::pair<std::int64_t, int>> got, want;
+    for (int op = 0; op < kOps; ++op) {
+        report.steps++;
+        const unsigned kind = rng() % 8;
+        const int id = (int)(rng() % kTimers);
+
+        if (kind < 4) {
+            // Some deadlines already past, most ahead at any scale.
+            const std::int64_t deadlineUs = nowUs + span() * resUs - (std::int64_t)(rng() % (2 * resUs));
+            wheel.Schedule(id, deadlineUs);
+            const std::int64_t since = deadlineUs - startUs;
+            expiry[(size_t)id] = std::max(since > 0 ? (since + resUs - 1) / resUs : 0, tick);
+        } else if (kind < 5) {
+            wheel.Cancel(id);
+            expiry[(size_t)id] = -1;
+        } else {
+            // Advance to the next expiry (exactly, or past it) or by a random span.
+            const std::int64_t next = wheel.NextExpiryUs();
+            if (kind == 5 && next >= nowUs) nowUs = next;
+            else if (kind == 6 && next >= nowUs) nowUs = next + (std::int64_t)(rng() % (4 * resUs));
+            else nowUs += span() * resUs / 16 + (std::int64_t)(rng() % resUs);
+
+            due.clear();
+            wheel.Expire(nowUs, due);
+            const std::int64_t target = (nowUs - startUs) / resUs;
+
+            // Due slot by slot: expiry ticks must not go backwards within a batch.
+            got.clear();
+            for (int d : due) {
+                if (!got.empty() && expiry[(size_t)d] < got.back().first) return "timer wheel expired slots out of order";
+                got.emplace_back(expiry[(size_t)d], d);
+            }
+            want.clear();
+            for (int t = 0; t < kTimers; ++t) {
+                if (expiry[(size_t)t] >= 0 && expiry[(size_t)t] <= target) {
+                    want.emplace_back(expiry[(size_t)t], t);
+                    expiry[(size_t)t] = -1;
+                }
+            }
+            std::sort(got.begin(), got.end());
+            std::sort(want.begin(), want.end());
+            if (got != want) return "timer wheel expired a different set of timers than due";
+            tick = std::max(tick, target + 1);
+        }
+
+        int armed = 0;
+        std::int64_t earliest = -1;
+        for (int t = 0; t < kTimers; ++t) {
+            const bool refArmed = expiry[(size_t)t] >= 0;
+            if (refArmed != wheel.Scheduled(t)) return "timer wheel armed state differs from reference";
+            if (!refArmed) continue;
+            armed++;
+            if (earliest < 0 || expiry[(size_t)t] < earliest) earliest = expiry[(size_t)t];
+        }
+        if (armed != wheel.Size()) return "timer wheel size differs from reference";
+
+        // NextExpiryUs: never after the earliest expiry, never before the wheel position.
+        const std::int64_t next = wheel.NextExpiryUs();
+        if ((next < 0) != (armed == 0)) return "timer wheel next expiry disagrees with armed timers";
+        if (armed && (next > startUs + earliest * resUs || next < startUs + tick * resUs)) {
+            return "timer wheel next expiry outside [wheel position, earliest expiry]";
+        }
+    }
+    return nullptr;
+}
+
+// Runs one combination to termination or a repeated state; returns the first violation.
+const char* ExploreCombination(const Settings& s, Engine& engine, CheckingSink& sink,
+                               std::vector<unsigned char>& visited, ExploreReport& report) {
+    const int cells = s.TotalCells();
+    const bool freeRunning = (s.mode == Mode::RandomGroupings && !s.wholeLine);
+
+    const char* violation = nullptr;
+
+    // Random groupings sprinkle cells with probability; only the stepping is checked.
+    sink.Reset(cells, s.wholeLine);
+    sink.checkPhase = !freeRunning;
+    sink.expectOn = true;
+
+    // State = (stepIndex, dashSubStep, phaseOn); pigeonhole bounds the walk.
+    visited.assign((size_t)cells * 8, 0);
+
+    engine.Start(s, 1);
+    while (engine.Running()) {
+        if (engine.Finishing()) {
+            // Last ON frame without an OFF phase; this tick only stops.
+            sink.expectOn = false;
+            engine.Tick();
+            report.steps++;
+            if (!sink.badFrame && engine.Running()) sink.badFrame = "pending finish did not stop the pass";
+            break;
+        }
+
+        const int step = engine.StepIndex();
+        const int dash = engine.DashSubStep();
+        if (step < 0 || step >= cells) { violation = "step index out of range while running"; break; }
+        if (dash < 0 || dash > 3) { violation = "dash sub-step out of range"; break; }
+
+        const size_t key = ((size_t)step * 4 + (size_t)dash) * 2 + (engine.PhaseOn() ? 1 : 0);
+        if (visited[key]) break; // cycle
+        visited[key] = 1;
+
+        sink.expectOn = engine.PhaseOn();
+        engine.Tick();
+        report.steps++;
+
+        if (sink.badFrame) break;
+    }
+
+    if (!violation && sink.badFrame) violation = sink.badFrame;
+
+    const bool terminated = !engine.Running();
+    if (!violation) {
+        if (freeRunning) {
+            if (terminated) violation = "random groupings stopped by itself";
+            else report.freeRunning++;
+        } else if (!s.loop && !terminated) {
+            violation = "pass did not terminate with loop off";
+        } else if (s.loop && terminated) {
+            violation = "pass stopped with loop on";
+        } else if (sink.seenCount != cells) {
+            violation = "not every cell was lit";
+        }
+    }
+
+    // Stop path: blank line published, later ticks are no-ops.
+    sink.checkPhase = false;
+    engine.Stop();
+    if (!violation && !sink.lastFrameBlank) violation = "stop did not leave a blank line";
+
+    const std::uint64_t framesAtStop = sink.frames;
+    engine.Tick();
+    if (!violation && sink.frames != framesAtStop) violation = "tick after stop published a frame";
+
+    return violation;
+}
+
+// Branch-free batched advance vs the scalar one, every combination in one batch
+// for long enough that each pass with loop off ends. Returns the first differing
+// tick per session (-1 if none).
+std::vector<int> CheckBatchedAdvance(SessionBatch& branchFree, SessionBatch& scalar, int ticks) {
+    const int n = branchFree.Size();
+    std::vector<int> firstDiff((size_t)n, -1);
+
+    for (int t = 0; t < ticks; ++t) {
+        branchFree.AdvanceAll();
+        scalar.AdvanceAllScalar();
+        for (int i = 0; i < n; ++i) {
+            if (firstDiff[(size_t)i] >= 0) continue;
+            if (branchFree.Running(i) != scalar.Running(i) ||
+                branchFree.Finishing(i) != scalar.Finishing(i) ||
+                branchFree.PhaseOn(i) != scalar.PhaseOn(i) ||
+                branchFree.StepIndex(i) != scalar.StepIndex(i) ||
+                branchFree.DashSubStep(i) != scalar.DashSubStep(i) ||
+                branchFree.StopMask()[(size_t)i] != scalar.StopMask()[(size_t)i]) {
+                firstDiff[(size_t)i] = t;
+            }
+        }
+    }
+    return firstDiff;
+}
+
+} // namespace
+
+ExploreReport ExploreStateSpace(int maxCols, int maxRows, std::FILE* out) {
+    ExploreReport report;
+
+    VirtualClock clock;
+    CheckingSink sink;
+    Engine engine;
+    engine.SetClock(&clock);
+    engine.SetSink(&sink);
+    engine.SetSuppressRedundantFrames(false);
+
+    std::vector<unsigned char> visited;
+    SessionBatch branchFree;
+    SessionBatch scalar;
+
+    for (int mode = 0; mode < kModeCount; ++mode) {
+        for (int flags = 0; flags < 8; ++flags) {
+            const int wholeLine = flags & 1;
+            const int loop = (flags >> 1) & 1;
+            const int noOff = (flags >> 2) & 1;
+
+            for (int cols = 1; cols <= maxCols; ++cols) {
+                for (int rows = 1; rows <= maxRows; ++rows) {
+                    Settings s;
+                    s.mode = (Mode)mode;
+                    s.wholeLine = (wholeLine != 0);
+                    s.loop = (loop != 0);
+                    s.cols = cols;
+                    s.rows = rows;
+                    s.intervalMs = 1;
+                    s.offMs = noOff ? 0 : -1;
+
+                    branchFree.Add(s, 1);
+                    scalar.Add(s, 1);
+
+                    report.combinations++;
+                    const char* violation = ExploreCombination(s, engine, sink, visited, report);
+                    if (!violation) continue;
+
+                    report.violations++;
+                    if (report.violations <= kMaxReportedViolations) {
+                        std::fprintf(out, "VIOLATION mode=%d wholeLine=%d loop=%d noOff=%d geometry=%dx%d: %s\n",
+                            mode, wholeLine, loop, noOff, cols, rows, violation);
+                    }
+                }
+            }
+        }
+    }
+
+    // Longest pass: every cell through four dash sub-steps, ON and OFF.
+    const std::vector<int> firstDiff = CheckBatchedAdvance(branchFree, scalar, maxCols * maxRows * 8 + 2);
+    for (int i = 0; i < branchFree.Size(); ++i) {
+        if (firstDiff[(size_t)i] < 0) continue;
+
+        report.violations++;
+        if (report.violations <= kMaxReportedViolations) {
+            const Settings& s = branchFree.GetSettings(i);
+            std::fprintf(out, "VIOLATION batched advance mode=%d wholeLine=%d loop=%d noOff=%d geometry=%dx%d: "
+                "differs from the scalar advance at tick %d\n",
+                (int)s.mode, s.wholeLine ? 1 : 0, s.loop ? 1 : 0, s.offMs == 0 ? 1 : 0, s.cols, s.rows,
+                firstDiff[(size_t)i]);
+        }
+    }
+
+    LitCellSink litSink;
+    engine.SetSink(&litSink);
+    for (int cols = 1; cols <= maxCols; ++cols) {
+        for (int rows = 1; rows <= maxRows; ++rows) {
+            report.combinations++;
+            const char* violation = CheckTraversalSwitch(cols, rows, engine, litSink, report);
+            if (!violation) continue;
+
+            report.violations++;
+            if (report.violations <= kMaxReportedViolations) {
+                std::fprintf(out, "VIOLATION traversal switch geometry=%dx%d: %s\n", cols, rows, violation);
+            }
+        }
+    }
+
+    for (std::uint32_t seed = 1; seed <= kTimerWheelSeeds; ++seed) {
+        const char* violation = CheckTimerWheel(seed, report);
+        if (!violation) continue;
+
+        report.violations++;
+        if (report.violations <= kMaxReportedViolations) {
+            std::fprintf(out, "VIOLATION timer wheel seed=%u: %s\n", seed, violation);
+        }
+    }
+
+    if (const char* violation = CheckRandomSwitch(engine, report)) {
+        report.violations++;
+        std::fprintf(out, "VIOLATION random groupings switch: %s\n", violation);
+    }
+
+    if (const char* violation = CheckPooledReuse(report)) {
+        report.violations++;
+        std::fprintf(out, "VIOLATION pooled reuse: %s\n", violation);
+    }
+
+    return report;
+}
+
+} // namespace calibration
@@ -0,0 +1,33 @@
+#pragma once
+
+// Exhaustive exploration of the tick/advance state machine.
+//
+// Enumerates every (mode, wholeLine, loop, OFF phase kept/dropped, cols x rows)
+// combination up to a geometry bound and drives the engine until the pass ends
+// or the stepping state (phase, step, dash sub-step) repeats. Along the way it checks:
+//   - step index and dash sub-step stay in range while running,
+//   - walking frames light at most one cell, OFF frames are blank,
+//   - every cell is lit at least once before the pass ends or cycles,
+//   - the pass terminates when loop is off,
+//   - the stop path publishes a blank line and later ticks are no-ops,
+//   - a live switch between row- and column-major order keeps the same cell,
+//   - a pooled engine reused with suppression on sends each session's first frame,
+//   - the branch-free batched advance (SessionBatch) matches the scalar one,
+//   - a TimerWheel under random schedule/cancel/expire expires exactly the
+//     timers a plain reference says are due.
+
+#include <cstdint>
+#include <cstdio>
+
+namespace calibration {
+
+struct ExploreReport {
+    int combinations = 0;
+    int violations = 0;
+    int freeRunning = 0;        // random groupings: loop is ignored by design
+    std::uint64_t steps = 0;    // engine ticks executed
+};
+
+ExploreReport ExploreStateSpace(int maxCols, int maxRows, std::FILE* out);
+
+} // namespace calibration
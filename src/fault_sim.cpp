@@ -0,0 +1,338 @@
+#include "fault_sim.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "work_stealing.h"
+
+namespace calibration {
+
+namespace {
+
+constexpr int kTrialsPerChunk = 128;
+constexpr std::size_t kMaxRecordedCells = (std::size_t)1 << 28;  // 256 MB of masks
+
+// Recorded frame stream of one plan: frame f is masks[f * cells .. + cells).
+struct PlanFrames {
+    int cols = 0;
+    int cells = 0;
+    std::vector<std::uint8_t> masks;
+    std::vector<std::int64_t> startUs;
+    std::vector<std::int64_t> durationUs;
+    std::vector<std::uint8_t> judgeable;    // operator knows what the frame should show
+    std::int64_t lengthUs = 0;
+};
+
+class RecordingSink : public FrameSink {
+public:
+    RecordingSink(PlanFrames& frames, bool predictable) : frames_(frames), predictable_(predictable) {}
+
+    void SetPredictable(bool on) { predictable_ = on; }
+
+    void WriteFrame(const std::wstring& line, std::int64_t timeUs) override {
+        if (frames_.masks.size() + (size_t)frames_.cells > kMaxRecordedCells) return;
+        bool blank = true;
+        for (int i = 0; i < frames_.cells; ++i) {
+            const wchar_t cell = i < (int)line.size() ? line[(size_t)i] : kBrailleBlank;
+            const std::uint8_t mask = (std::uint8_t)(cell - kBrailleBlank);
+            frames_.masks.push_back(mask);
+            blank = blank && mask == 0;
+        }
+        frames_.startUs.push_back(timeUs);
+        frames_.judgeable.push_back(predictable_ || blank ? 1 : 0);
+    }
+
+private:
+    PlanFrames& frames_;
+    bool predictable_;
+};
+
+bool FreeRunning(const Settings& s) {
+    return s.mode == Mode::RandomGroupings && !s.wholeLine;
+}
+
+void RecordPlan(const FaultPlan& plan, PlanFrames& frames) {
+    const Settings& first = plan.steps.front();
+    frames.cols = first.cols;
+    frames.cells = first.TotalCells();
+
+    // One clock for the whole plan: each step starts where the last one ended.
+    VirtualClock clock;
+    RecordingSink sink(frames, true);
+    for (Settings s : plan.steps) {
+        s.cols = first.cols;
+        s.rows = first.rows;
+        s.loop = false;
+        const std::int64_t capUs = FreeRunning(s)
+            ? 1000LL * s.TotalCells() * (s.intervalMs + s.OffDurationMs())
+            : std::numeric_limits<std::int64_t>::max();
+
+        Engine engine;
+        engine.SetClock(&clock);
+        engine.SetSink(&sink);
+        sink.SetPredictable(s.mode != Mode::RandomGroupings);
+
+        const std::int64_t startUs = clock.NowUs();
+        engine.Start(s, 1);
+        while (engine.Running() && engine.NextTickUs() - startUs < capUs) {
+            clock.AdvanceTo(engine.NextWakeUs());
+            engine.PrepareTick();
+            clock.AdvanceTo(engine.NextTickUs());
+            engine.Tick();
+        }
+        if (engine.Running()) {
+            clock.AdvanceTo(engine.NextTickUs());
+            engine.Stop();
+        }
+        // The final blank (the last OFF tick of a pass that ended by itself, or
+        // the stop blank of a capped free-running one) stays up for an OFF phase.
+        clock.AdvanceTo(clock.NowUs() + 1000LL * s.OffDurationMs());
+    }
+
+    // A frame stays up until the next one, the last one until the plan ends.
+    const size_t n = frames.startUs.size();
+    frames.durationUs.resize(n);
+    for (size_t f = 0; f < n; ++f) {
+        frames.durationUs[f] = (f + 1 < n ? frames.startUs[f + 1] : clock.NowUs()) - frames.startUs[f];
+    }
+    frames.lengthUs = clock.NowUs();
+}
+
+// Bit index (dot 1..8 -> bit 0..7) to position in the 2 x 4 dot grid.
+void DotPosition(int bit, int& row, int& col) {
+    static const int kRow[8] = { 0, 1, 2, 0, 1, 2, 3, 3 };
+    static const int kCol[8] = { 0, 0, 0, 1, 1, 1, 0, 1 };
+    row = kRow[bit];
+    col = kCol[bit];
+}
+
+int DotAt(int row, int col) {
+    static const int kBit[4][2] = { { 0, 3 }, { 1, 4 }, { 2, 5 }, { 6, 7 } };
+    return kBit[row][col];
+}
+
+// A pin touching (cell, bit): above/below or beside it in the cell, or the
+// touching column of the cell to the left/right on the same display row.
+void PickNeighbour(int cols, int cells, int cell, int bit, std::mt19937& rng, int& nCell, int& nBit) {
+    int row, col;
+    DotPosition(bit, row, col);
+    int cellAt[4], bitAt[4];
+    int count = 0;
+    if (row > 0) { cellAt[count] = cell; bitAt[count++] = DotAt(row - 1, col); }
+    if (row < 3) { cellAt[count] = cell; bitAt[count++] = DotAt(row + 1, col); }
+    cellAt[count] = cell;
+    bitAt[count++] = DotAt(row, 1 - col);
+    if (col == 0 && cell % cols > 0) { cellAt[count] = cell - 1; bitAt[count++] = DotAt(row, 1); }
+    if (col == 1 && cell % cols < cols - 1 && cell + 1 < cells) {
+        cellAt[count] = cell + 1;
+        bitAt[count++] = DotAt(row, 0);
+    }
+    const int k = std::uniform_int_distribution<int>(0, count - 1)(rng);
+    nCell = cellAt[k];
+    nBit = bitAt[k];
+}
+
+// One virtual display with one faulty pin. Returns the plan time at which the
+// operator notices it, or -1.
+std::int64_t RunTrial(const PlanFrames& f, FaultModel model, const FaultConfig& config, std::mt19937& rng) {
+    FaultyPin pin = FaultyPin::Random(model, f.cols, f.cells, config, rng);
+    std::bernoulli_distribution notice(config.noticeProbability);
+    const std::int64_t minVisibleUs = 1000LL * config.minVisibleMs;
+
+    const size_t frames = f.startUs.size();
+    for (size_t i = 0; i < frames; ++i) {
+        const std::int64_t startUs = f.startUs[i];
+        const std::int64_t wrongUs = pin.WrongUs(&f.masks[i * (size_t)f.cells], startUs, f.durationUs[i], rng);
+        if (wrongUs >= minVisibleUs && f.judgeable[i] && notice(rng)) return startUs + minVisibleUs;
+    }
+    return -1;
+}
+
+void Summarize(const std::vector<std::int64_t>& times, FaultModelResult& r) {
+    r.trials = (int)times.size();
+    std::vector<std::int64_t> detected;
+    detected.reserve(times.size());
+    for (std::int64_t t : times) {
+        if (t >= 0) detected.push_back(t);
+    }
+    r.detected = (int)detected.size();
+    if (detected.empty()) return;
+    std::sort(detected.begin(), detected.end());
+    double sum = 0.0;
+    for (std::int64_t t : detected) sum += (double)t;
+    r.meanDetectUs = sum / (double)detected.size();
+    r.p50DetectUs = detected[(detected.size() - 1) / 2];
+    r.p90DetectUs = detected[std::min(detected.size() - 1, (size_t)(detected.size() * 0.9))];
+}
+
+std::string StepName(const Settings& s) {
+    return std::to_string((int)s.mode) + (s.wholeLine ? "w" : "");
+}
+
+FaultPlan MakePlan(const std::vector<Settings>& steps) {
+    FaultPlan plan;
+    plan.steps = steps;
+    for (size_t i = 0; i < steps.size(); ++i) {
+        if (i) plan.name += '+';
+        plan.name += StepName(steps[i]);
+    }
+    if (steps.size() == 1) {
+        // Labels are ASCII.
+        for (wchar_t c : ModeLabel(steps[0].mode)) plan.description += (char)c;
+        if (steps[0].wholeLine) plan.description += ", whole line";
+    } else {
+        plan.description = std::to_string(steps.size()) + " steps";
+    }
+    return plan;
+}
+
+} // namespace
+
+FaultyPin FaultyPin::Random(FaultModel model, int cols, int cells, const FaultConfig& config, std::mt19937& rng) {
+    FaultyPin pin;
+    pin.model_ = model;
+    pin.cell_ = std::uniform_int_distribution<int>(0, cells - 1)(rng);
+    pin.bit_ = std::uniform_int_distribution<int>(0, 7)(rng);
+    pin.sourceCell_ = pin.cell_;
+    pin.sourceBit_ = pin.bit_;
+    if (model == FaultModel::Crosstalk) {
+        PickNeighbour(cols, cells, pin.cell_, pin.bit_, rng, pin.sourceCell_, pin.sourceBit_);
+    }
+    pin.riseUs_ = 1000LL * std::uniform_int_distribution<int>(config.slowRiseMinMs, config.slowRiseMaxMs)(rng);
+    pin.failRate_ = std::uniform_real_distribution<double>(config.intermittentMin, config.intermittentMax)(rng);
+    return pin;
+}
+
+std::int64_t FaultyPin::WrongUs(const std::uint8_t* masks, std::int64_t startUs, std::int64_t durUs,
+                                std::mt19937& rng) {
+    const bool up = (masks[cell_] >> bit_) & 1;
+    if (up && !wasUp_) {
+        upSinceUs_ = startUs;
+        failing_ = model_ == FaultModel::Intermittent && std::bernoulli_distribution(failRate_)(rng);
+    }
+    wasUp_ = up;
+
+    switch (model_) {
+    case FaultModel::StuckUp:
+        return up ? 0 : durUs;
+    case FaultModel::StuckDown:
+        return up ? durUs : 0;
+    case FaultModel::SlowRise:
+        return up ? std::min(durUs, std::max<std::int64_t>(0, upSinceUs_ + riseUs_ - startUs)) : 0;
+    case FaultModel::Crosstalk:
+        return (!up && ((masks[sourceCell_] >> sourceBit_) & 1)) ? durUs : 0;
+    case FaultModel::Intermittent:
+        return (up && failing_) ? durUs : 0;
+    }
+    return 0;
+}
+
+const char* FaultModelName(FaultModel model) {
+    switch (model) {
+    case FaultModel::StuckUp: return "stuck up";
+    case FaultModel::StuckDown: return "stuck down";
+    case FaultModel::SlowRise: return "slow rise";
+    case FaultModel::Crosstalk: return "crosstalk";
+    case FaultModel::Intermittent: return "intermittent";
+    default: return "(unknown)";
+    }
+}
+
+double FaultPlanResult::Probability() const {
+    double sum = 0.0;
+    for (const FaultModelResult& m : models) sum += m.Probability();
+    return sum / kFaultModelCount;
+}
+
+std::vector<FaultPlan> DefaultFaultPlans(const Settings& base) {
+    std::vector<FaultPlan> plans;
+    for (int m = 0; m < kModeCount; ++m) {
+        Settings s = base;
+        s.mode = (Mode)m;
+        s.wholeLine = false;
+        plans.push_back(MakePlan({ s }));
+    }
+    const Mode wholeLine[] = { Mode::AllDots_RowMajor, Mode::RandomGroupings,
+                               Mode::DashesCycle_14_25_36_78, Mode::Alternate1237_4568 };
+    for (Mode m : wholeLine) {
+        Settings s = base;
+        s.mode = m;
+        s.wholeLine = true;
+        plans.push_back(MakePlan({ s }));
+    }
+    return plans;
+}
+
+bool ParseFaultPlans(const char* text, const Settings& base, std::vector<FaultPlan>& plans) {
+    plans.clear();
+    std::vector<Settings> steps;
+    const char* p = text;
+    for (;;) {
+        char* end = nullptr;
+        const long mode = std::strtol(p, &end, 10);
+        if (end == p || mode < 0 || mode >= kModeCount) return false;
+        Settings s = base;
+        s.mode = (Mode)mode;
+        s.wholeLine = *end == 'w';
+        if (s.wholeLine) ++end;
+        steps.push_back(s);
+
+        if (*end == '+') {
+            p = end + 1;
+            continue;
+        }
+        plans.push_back(MakePlan(steps));
+        steps.clear();
+        if (*end == '\0') return true;
+        if (*end != ',') return false;
+        p = end + 1;
+    }
+}
+
+FaultReport RunFaultSimulation(const std::vector<FaultPlan>& plans, const FaultConfig& config) {
+    FaultReport report;
+    std::vector<PlanFrames> frames(plans.size());
+    for (size_t p = 0; p < plans.size(); ++p) {
+        if (!plans[p].steps.empty()) RecordPlan(plans[p], frames[p]);
+    }
+
+    // times[plan][model][trial]: detection time or -1. Chunks never share a slot.
+    const int trials = std::max(config.trials, 1);
+    const int chunksPerModel = (trials + kTrialsPerChunk - 1) / kTrialsPerChunk;
+    const int chunksPerPlan = chunksPerModel * kFaultModelCount;
+    std::vector<std::vector<std::int64_t>> times(plans.size() * kFaultModelCount,
+        std::vector<std::int64_t>((size_t)trials, -1));
+
+    WorkStealingPool pool(config.workers);
+    pool.Run((int)plans.size() * chunksPerPlan, [&](int chunk, int) {
+        const int plan = chunk / chunksPerPlan;
+        const int model = (chunk % chunksPerPlan) / chunksPerModel;
+        const int first = (chunk % chunksPerModel) * kTrialsPerChunk;
+        const int last = std::min(trials, first + kTrialsPerChunk);
+        const PlanFrames& f = frames[(size_t)plan];
+        if (f.cells <= 0 || f.startUs.empty()) return;
+
+        std::seed_seq seq{ config.seed, (std::uint32_t)chunk };
+        std::mt19937 rng(seq);
+        std::vector<std::int64_t>& out = times[(size_t)plan * kFaultModelCount + (size_t)model];
+        for (int t = first; t < last; ++t) out[(size_t)t] = RunTrial(f, (FaultModel)model, config, rng);
+    });
+
+    report.workers = pool.Workers();
+    for (size_t p = 0; p < plans.size(); ++p) {
+        FaultPlanResult r;
+        r.name = plans[p].name;
+        r.description = plans[p].description;
+        r.lengthUs = frames[p].lengthUs;
+        r.frames = frames[p].startUs.size();
+        for (int m = 0; m < kFaultModelCount; ++m) {
+            Summarize(times[p * kFaultModelCount + (size_t)m], r.models[m]);
+        }
+        report.trials += (std::uint64_t)trials * kFaultModelCount;
+        report.plans.push_back(r);
+    }
+    return report;
+}
+
+} // namespace calibration
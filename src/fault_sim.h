@@ -0,0 +1,141 @@
+#pragma once
+
+// Fault-model simulation: how likely a test plan is to expose a defective pin,
+// and how soon.
+//
+// A plan (one or more mode settings, each run for one pass) is played once on
+// a virtual clock and its frame stream recorded: the dot mask of every cell
+// and how long each frame stays up. Then, many times per fault model, a
+// virtual display gets one faulty pin at a random cell and dot, and the
+// recorded frames are replayed against it:
+//
+//   stuck up       the pin is always raised
+//   stuck down     the pin never rises
+//   slow rise      the pin comes up a random 50..400 ms after it is commanded
+//   crosstalk      the pin rises whenever an adjacent pin (same cell, or the
+//                  touching column of the neighbouring cell) is raised
+//   intermittent   each time it is commanded up, the pin fails to rise with a
+//                  random probability of 5..30 % until the next command
+//
+// The operator notices a frame with a wrong pin with a fixed probability if
+// the discrepancy lasts at least a perceptible time, and only in frames whose
+// content they can predict: random groupings can only be judged when blank.
+// The result per plan is the detection probability and time to detect per
+// fault model, and detections per minute of plan time.
+//
+// Trials are independent and run on a work-stealing pool. Each chunk of trials
+// has its own seeded generator, so results do not depend on the worker count.
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+enum class FaultModel : int {
+    StuckUp = 0,
+    StuckDown = 1,
+    SlowRise = 2,
+    Crosstalk = 3,
+    Intermittent = 4
+};
+
+constexpr int kFaultModelCount = 5;
+
+const char* FaultModelName(FaultModel model);
+
+struct FaultConfig {
+    int trials = 1000;                  // virtual displays per plan and fault model
+    int workers = 0;                    // <= 0: one per hardware thread
+    std::uint32_t seed = 1;
+
+    double noticeProbability = 0.5;     // a visible discrepancy frame is noticed
+    int minVisibleMs = 40;              // shorter discrepancies go unnoticed
+    int slowRiseMinMs = 50;
+    int slowRiseMaxMs = 400;
+    double intermittentMin = 0.05;
+    double intermittentMax = 0.30;
+};
+
+// One faulty pin of a virtual display. Frames are fed in display order, each
+// as the dot masks of the whole line; the pin keeps what it needs (rise time,
+// whether an intermittent failure is in progress) between them.
+class FaultyPin {
+public:
+    // Random cell and dot on a cols-wide line of `cells` cells; the crosstalk
+    // source is a random touching pin.
+    static FaultyPin Random(FaultModel model, int cols, int cells, const FaultConfig& config, std::mt19937& rng);
+
+    FaultModel Model() const { return model_; }
+    int Cell() const { return cell_; }
+
+    // How long the pin shows the wrong state during a frame shown at startUs
+    // for durUs. rng draws intermittent failures.
+    std::int64_t WrongUs(const std::uint8_t* masks, std::int64_t startUs, std::int64_t durUs, std::mt19937& rng);
+
+private:
+    FaultModel model_ = FaultModel::StuckDown;
+    int cell_ = 0;
+    int bit_ = 0;
+    int sourceCell_ = 0;              // crosstalk: the pin that drags this one up
+    int sourceBit_ = 0;
+    std::int64_t riseUs_ = 0;
+    double failRate_ = 0.0;
+
+    bool wasUp_ = false;
+    bool failing_ = false;
+    std::int64_t upSinceUs_ = 0;
+};
+
+// Steps run one after another, each for one pass (loop off). All steps use
+// the geometry of the first. Random groupings, which never finish a pass by
+// themselves, run for as long as a walking pass over the line.
+struct FaultPlan {
+    std::string name;                   // "0", "3w", "0+3"
+    std::string description;
+    std::vector<Settings> steps;
+};
+
+// Every mode as a walk, plus whole-line blink for all dots, random, dashes and
+// the alternating pattern; timing and geometry from base.
+std::vector<FaultPlan> DefaultFaultPlans(const Settings& base);
+
+// Comma-separated plans, each a '+'-joined list of mode indices with an
+// optional 'w' for whole-line blink: "0,3,0+3w". False on a syntax error.
+bool ParseFaultPlans(const char* text, const Settings& base, std::vector<FaultPlan>& plans);
+
+struct FaultModelResult {
+    int trials = 0;
+    int detected = 0;
+    double meanDetectUs = 0.0;          // over detected trials, from plan start
+    std::int64_t p50DetectUs = 0;
+    std::int64_t p90DetectUs = 0;
+
+    double Probability() const { return trials ? (double)detected / trials : 0.0; }
+};
+
+struct FaultPlanResult {
+    std::string name;
+    std::string description;
+    std::int64_t lengthUs = 0;          // plan run time
+    std::uint64_t frames = 0;
+    FaultModelResult models[kFaultModelCount];
+
+    // Mean over the fault models.
+    double Probability() const;
+    // Faults found per minute of plan time (one fault per display).
+    double DetectedPerMinute() const { return lengthUs > 0 ? Probability() * 60e6 / (double)lengthUs : 0.0; }
+};
+
+struct FaultReport {
+    std::vector<FaultPlanResult> plans;
+    int workers = 1;
+    std::uint64_t trials = 0;
+};
+
+FaultReport RunFaultSimulation(const std::vector<FaultPlan>& plans, const FaultConfig& config);
+
+} // namespace calibration
@@ -0,0 +1,261 @@
+#include "fleet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "calibration_engine.h"
+#include "scheduler.h"
+#include "session_pool.h"
+#include "timer_wheel.h"
+
+namespace calibration {
+
+namespace {
+
+constexpr double kReplaySeconds = 300.0;
+
+class DiscardSink : public FrameSink {
+public:
+    void WriteFrame(const std::wstring&, std::int64_t) override {}
+};
+
+// Intervals spread over 40..1000 ms, OFF phase same / none / shorter / longer.
+// Every 64th session is an 80 x 25 random whole-line display.
+Settings FleetSettings(int i) {
+    Settings s;
+    s.cols = 40;
+    s.rows = 1;
+    s.mode = (Mode)(i % kModeCount);
+    if (i % 64 == 63) {
+        s.cols = 80;
+        s.rows = 25;
+        s.mode = Mode::RandomGroupings;
+        s.wholeLine = true;
+    }
+    s.intervalMs = 40 + (int)((i * 7919LL) % 961);
+    switch (i % 4) {
+    case 0: s.offMs = -1; break;
+    case 1: s.offMs = 0; break;
+    case 2: s.offMs = s.intervalMs / 2; break;
+    default: s.offMs = s.intervalMs * 3 / 2; break;
+    }
+    return s;
+}
+
+struct ReplaySession {
+    std::int64_t deadlineUs = 0;
+    int onMs = 0;
+    int offMs = 0;
+    bool phaseOn = true;
+
+    // Deadline after the current one: the phase now shown stays up for its duration.
+    std::int64_t Advance() {
+        deadlineUs += 1000LL * (phaseOn ? onMs : offMs);
+        if (offMs > 0) phaseOn = !phaseOn;
+        return deadlineUs;
+    }
+};
+
+std::vector<ReplaySession> ReplaySessions(int n) {
+    std::vector<ReplaySession> sessions((size_t)n);
+    for (int i = 0; i < n; ++i) {
+        const Settings s = FleetSettings(i);
+        ReplaySession& r = sessions[(size_t)i];
+        r.onMs = s.intervalMs;
+        r.offMs = s.OffDurationMs();
+        r.deadlineUs = 1000LL * s.intervalMs;
+    }
+    return sessions;
+}
+
+double ElapsedSeconds(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+using HeapEntry = std::pair<std::int64_t, int>;   // (deadline, session)
+using MinHeap = std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>>;
+
+// Runs the wheel and the heap in lockstep over the same deadline pattern and
+// returns the index of the first expiry where they disagree, -1 if none. Each
+// wheel batch is put in (deadline, session) order, which is the heap's order,
+// and every session must fire exactly at its deadline.
+std::int64_t CompareQueues(int n, std::int64_t endUs) {
+    std::vector<ReplaySession> wheelSessions = ReplaySessions(n);
+    std::vector<ReplaySession> heapSessions = wheelSessions;
+
+    TimerWheel wheel(0, 1000);
+    wheel.Reserve(n);
+    MinHeap heap;
+    for (int i = 0; i < n; ++i) {
+        wheel.Schedule(i, wheelSessions[(size_t)i].deadlineUs);
+        heap.emplace(heapSessions[(size_t)i].deadlineUs, i);
+    }
+
+    std::vector<int> due;
+    std::vector<HeapEntry> batch;
+    std::int64_t index = 0;
+    for (;;) {
+        const std::int64_t next = wheel.NextExpiryUs();
+        if (next < 0 || next > endUs) break;
+        due.clear();
+        wheel.Expire(next, due);
+
+        batch.clear();
+        for (int id : due) batch.emplace_back(wheelSessions[(size_t)id].deadlineUs, id);
+        std::sort(batch.begin(), batch.end());
+        for (const HeapEntry& e : batch) {
+            if (e.first != next || heap.empty() || heap.top() != e) return index;
+            heap.pop();
+            heap.emplace(heapSessions[(size_t)e.second].Advance(), e.second);
+            wheel.Schedule(e.second, wheelSessions[(size_t)e.second].Advance());
+            index++;
+        }
+    }
+
+    // Anything still due in the heap was never expired by the wheel.
+    if (!heap.empty() && heap.top().first <= endUs) return index;
+    return -1;
+}
+
+void ReplayQueues(int n, FleetReport& report) {
+    const std::int64_t endUs = (std::int64_t)(kReplaySeconds * 1e6);
+
+    // Deadlines are whole milliseconds, so a 1 ms wheel expires exactly on time
+    // and both queues see the same events.
+    std::uint64_t wheelExpiries = 0;
+    {
+        std::vector<ReplaySession> sessions = ReplaySessions(n);
+        TimerWheel wheel(0, 1000);
+        wheel.Reserve(n);
+        for (int i = 0; i < n; ++i) wheel.Schedule(i, sessions[(size_t)i].deadlineUs);
+
+        std::vector<int> due;
+        due.reserve((size_t)n);
+        const auto start = std::chrono::steady_clock::now();
+        for (;;) {
+            const std::int64_t next = wheel.NextExpiryUs();
+            if (next < 0 || next > endUs) break;
+            due.clear();
+            wheel.Expire(next, due);
+            for (int id : due) {
+                wheelExpiries++;
+                wheel.Schedule(id, sessions[(size_t)id].Advance());
+            }
+        }
+        report.wheelSeconds = ElapsedSeconds(start);
+    }
+
+    std::uint64_t heapExpiries = 0;
+    {
+        std::vector<ReplaySession> sessions = ReplaySessions(n);
+        std::vector<HeapEntry> storage;
+        storage.reserve((size_t)n);
+        MinHeap heap(std::greater<HeapEntry>(), std::move(storage));
+        for (int i = 0; i < n; ++i) heap.emplace(sessions[(size_t)i].deadlineUs, i);
+
+        const auto start = std::chrono::steady_clock::now();
+        while (!heap.empty() && heap.top().first <= endUs) {
+            const int id = heap.top().second;
+            heap.pop();
+            heapExpiries++;
+            heap.emplace(sessions[(size_t)id].Advance(), id);
+        }
+        report.heapSeconds = ElapsedSeconds(start);
+    }
+
+    report.queueExpiries = wheelExpiries;
+    report.queueMismatchAt = CompareQueues(n, endUs);
+    if (report.queueMismatchAt < 0 && wheelExpiries != heapExpiries) report.queueMismatchAt = 0;
+}
+
+} // namespace
+
+FleetReport RunFleet(const FleetConfig& config) {
+    FleetReport report;
+    const int n = config.sessions;
+
+    SteadyClock clock;
+    DiscardSink sink;
+    SessionPool pool;
+    std::vector<Engine*> engines((size_t)n);
+
+    // Create every engine before the first one starts, so allocation is not
+    // charged to the early deadlines.
+    for (int i = 0; i < n; ++i) engines[(size_t)i] = pool.Acquire(FleetSettings(i).TotalCells());
+
+    const std::int64_t startUs = clock.NowUs();
+    const std::int64_t endUs = startUs + (std::int64_t)(config.seconds * 1e6);
+    TimerWheel wheel(startUs, config.resolutionUs);
+    wheel.Reserve(n);
+    for (int i = 0; i < n; ++i) {
+        Engine* e = engines[(size_t)i];
+        e->SetClock(&clock);
+        e->SetSink(&sink);
+        e->Start(FleetSettings(i), (std::uint32_t)i + 1);
+        wheel.Schedule(i, e->NextTickUs());
+    }
+
+    WorkStealingPool executor(config.workers);
+    std::vector<int> due, weights, bounds;
+    due.reserve((size_t)n);
+    weights.reserve((size_t)n);
+    bounds.reserve((size_t)n + 1);
+
+    for (;;) {
+        const std::int64_t next = wheel.NextExpiryUs();
+        if (next < 0 || next > endUs) break;
+        SleepUntilUs(clock, next);
+
+        const std::int64_t wakeUs = clock.NowUs();
+        due.clear();
+        if (wheel.Expire(wakeUs, due) == 0) continue; // redistribution only
+
+        report.wakes++;
+        report.maxBatch = std::max(report.maxBatch, (int)due.size());
+
+        // Generation stage. Due sessions come slot by slot, so chunk order is
+        // deadline order.
+        weights.clear();
+        int cells = 0;
+        for (int id : due) {
+            weights.push_back(engines[(size_t)id]->GetSettings().TotalCells());
+            cells += weights.back();
+        }
+        if (executor.Workers() > 1 && cells > 2 * config.grainCells) {
+            const int chunks = MakeWeightedChunks(weights, config.grainCells, bounds);
+            executor.Run(chunks, [&](int chunk, int) {
+                for (int k = bounds[(size_t)chunk]; k < bounds[(size_t)chunk + 1]; ++k) {
+                    engines[(size_t)due[(size_t)k]]->PrepareTick();
+                }
+            });
+            report.pooledBatches++;
+        } else {
+            for (int id : due) engines[(size_t)id]->PrepareTick();
+        }
+
+        // Publish stage, on this thread.
+        for (int id : due) {
+            Engine& e = *engines[(size_t)id];
+            const std::int64_t dispatchUs = clock.NowUs();
+            report.wakeToDispatch.Add(dispatchUs - wakeUs);
+            report.lateness.Add(dispatchUs - e.NextTickUs());
+
+            e.Tick();
+            report.ticks++;
+            if (e.Running()) wheel.Schedule(id, e.NextTickUs());
+        }
+    }
+
+    for (Engine* e : engines) pool.Release(e);
+    for (int w = 0; w < executor.Workers(); ++w) report.workers.push_back(executor.Stats(w));
+    report.poolBatchUs = executor.BatchUs();
+
+    ReplayQueues(n, report);
+    return report;
+}
+
+} // namespace calibration
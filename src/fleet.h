@@ -0,0 +1,57 @@
+#pragma once
+
+// Fleet simulation: thousands of calibration sessions with mixed intervals and
+// duty cycles, driven in real time by one thread through a TimerWheel. One in
+// 64 sessions is a large random whole-line display, so frame costs are skewed.
+//
+// The thread sleeps until the wheel's next expiry and takes every session due
+// in the expired slots as one batch. Frames for the batch are generated on a
+// work-stealing pool (chunks of sessions in deadline order, each up to a cell
+// budget), then published in deadline order on the driving thread. Small
+// batches are generated inline; waking the pool would cost more.
+//
+// For each dispatch the run records the time since the wake-up (wake to
+// dispatch: how long the batch ahead of a session took) and since the
+// session's deadline. A second, virtual-time pass replays the same deadline
+// pattern through the wheel and through a binary heap to compare the cost of
+// the timer queue alone, and checks that both expire the same sessions at the
+// same deadlines in the same order.
+
+#include <cstdint>
+#include <vector>
+
+#include "soak.h"
+#include "work_stealing.h"
+
+namespace calibration {
+
+struct FleetConfig {
+    int sessions = 10000;
+    double seconds = 10.0;          // real-time run length
+    std::int64_t resolutionUs = 250; // wheel slot width
+    int workers = 0;                // generation threads, <= 0: one per hardware thread
+    int grainCells = 2048;          // cells per generation chunk
+};
+
+struct FleetReport {
+    std::uint64_t ticks = 0;        // session ticks dispatched
+    std::uint64_t wakes = 0;        // wake-ups that expired at least one session
+    int maxBatch = 0;               // most sessions expired by one wake-up
+    LatencyHistogram wakeToDispatch;
+    LatencyHistogram lateness;      // deadline to dispatch
+
+    // Generation stage
+    std::uint64_t pooledBatches = 0;     // batches generated on the pool
+    std::vector<WorkerStats> workers;    // per worker
+    std::int64_t poolBatchUs = 0;        // wall time of pooled batches
+
+    // Virtual-time replay of the deadline pattern, timer queue only.
+    std::uint64_t queueExpiries = 0;
+    std::int64_t queueMismatchAt = -1;   // first expiry where wheel and heap differ, -1 if none
+    double wheelSeconds = 0.0;
+    double heapSeconds = 0.0;
+};
+
+FleetReport RunFleet(const FleetConfig& config);
+
+} // namespace calibration
@@ -0,0 +1,129 @@
+#include "frame_diff.h"
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CALIBRATION_DIFF_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace calibration {
+
+namespace {
+
+constexpr int kBlockCells = 16;
+
+int LowestBit(std::uint32_t word) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, word);
+    return (int)index;
+#else
+    return __builtin_ctz(word);
+#endif
+}
+
+// Collects runs of changed cells and merges those at most `gap` apart.
+class SpanBuilder {
+public:
+    SpanBuilder(int gap, std::vector<CellSpan>& spans) : gap_(gap), spans_(spans) { spans_.clear(); }
+
+    void AddRun(int begin, int end) {
+        if (!spans_.empty() && begin - spans_.back().end <= gap_) {
+            spans_.back().end = end;
+        } else {
+            spans_.push_back({ begin, end });
+        }
+    }
+
+    // Bit i of `changed` set: cell base + i differs.
+    void AddMask(int base, std::uint32_t changed) {
+        while (changed) {
+            const int first = LowestBit(changed);
+            const std::uint32_t from = changed >> first;
+            const int length = (~from == 0) ? 32 - first : LowestBit(~from);
+            AddRun(base + first, base + first + length);
+            if (first + length >= 32) break;
+            changed &= ~0u << (first + length);
+        }
+    }
+
+private:
+    const int gap_;
+    std::vector<CellSpan>& spans_;
+};
+
+#ifdef CALIBRATION_DIFF_SSE2
+
+// One bit per cell for 16 cells: set where the cells differ.
+inline std::uint32_t ChangedMask16(const wchar_t* prev, const wchar_t* next) {
+    const __m128i* a = reinterpret_cast<const __m128i*>(prev);
+    const __m128i* b = reinterpret_cast<const __m128i*>(next);
+    if constexpr (sizeof(wchar_t) == 2) {
+        const __m128i eq0 = _mm_cmpeq_epi16(_mm_loadu_si128(a), _mm_loadu_si128(b));
+        const __m128i eq1 = _mm_cmpeq_epi16(_mm_loadu_si128(a + 1), _mm_loadu_si128(b + 1));
+        return ~(std::uint32_t)_mm_movemask_epi8(_mm_packs_epi16(eq0, eq1)) & 0xFFFFu;
+    }
+
+    // 32-bit cells: two saturating packs keep one byte per cell, in order.
+    const __m128i eq0 = _mm_cmpeq_epi32(_mm_loadu_si128(a), _mm_loadu_si128(b));
+    const __m128i eq1 = _mm_cmpeq_epi32(_mm_loadu_si128(a + 1), _mm_loadu_si128(b + 1));
+    const __m128i eq2 = _mm_cmpeq_epi32(_mm_loadu_si128(a + 2), _mm_loadu_si128(b + 2));
+    const __m128i eq3 = _mm_cmpeq_epi32(_mm_loadu_si128(a + 3), _mm_loadu_si128(b + 3));
+    const __m128i eq = _mm_packs_epi16(_mm_packs_epi32(eq0, eq1), _mm_packs_epi32(eq2, eq3));
+    return ~(std::uint32_t)_mm_movemask_epi8(eq) & 0xFFFFu;
+}
+
+#else
+
+inline std::uint32_t ChangedMask16(const wchar_t* prev, const wchar_t* next) {
+    std::uint32_t changed = 0;
+    for (int i = 0; i < kBlockCells; ++i) {
+        if (prev[i] != next[i]) changed |= 1u << i;
+    }
+    return changed;
+}
+
+#endif
+
+} // namespace
+
+int DiffFrames(const wchar_t* prev, const wchar_t* next, int cells, int mergeGap,
+               std::vector<CellSpan>& spans) {
+    SpanBuilder builder(mergeGap, spans);
+
+    int i = 0;
+    for (; i + kBlockCells <= cells; i += kBlockCells) {
+        const std::uint32_t changed = ChangedMask16(prev + i, next + i);
+        if (changed) builder.AddMask(i, changed);
+    }
+    std::uint32_t tail = 0;
+    for (int k = 0; i + k < cells; ++k) {
+        if (prev[i + k] != next[i + k]) tail |= 1u << k;
+    }
+    if (tail) builder.AddMask(i, tail);
+
+    return (int)spans.size();
+}
+
+int DiffFramesScalar(const wchar_t* prev, const wchar_t* next, int cells, int mergeGap,
+                     std::vector<CellSpan>& spans) {
+    SpanBuilder builder(mergeGap, spans);
+    int i = 0;
+    while (i < cells) {
+        if (prev[i] == next[i]) {
+            ++i;
+            continue;
+        }
+        const int begin = i;
+        while (i < cells && prev[i] != next[i]) ++i;
+        builder.AddRun(begin, i);
+    }
+    return (int)spans.size();
+}
+
+} // namespace calibration
@@ -0,0 +1,34 @@
+#pragma once
+
+// Dirty spans between two frames of the same size.
+//
+// Walking modes know which cells they touch, but random groupings, whole-line
+// frames and frames from outside the engine do not, so a delta sink has to
+// compare the previous and next frame. DiffFrames does that 16 cells at a
+// time with SSE2: equal blocks cost a few compares and one movemask, and the
+// changed-cell bitmask of a differing block is turned into runs with bit
+// scans instead of a per-cell loop. Builds without SSE2 use the scalar path.
+//
+// Runs separated by at most mergeGap unchanged cells are merged into one span:
+// for a terminal, rewriting two unchanged cells is cheaper than another
+// cursor move. mergeGap 0 reports exact runs.
+
+#include <vector>
+
+namespace calibration {
+
+struct CellSpan {
+    int begin = 0;  // first changed cell
+    int end = 0;    // one past the last
+};
+
+// Replaces spans with the dirty spans of next against prev, in cell order.
+// Returns the number of spans.
+int DiffFrames(const wchar_t* prev, const wchar_t* next, int cells, int mergeGap,
+               std::vector<CellSpan>& spans);
+
+// Cell-by-cell reference with the same output.
+int DiffFramesScalar(const wchar_t* prev, const wchar_t* next, int cells, int mergeGap,
+                     std::vector<CellSpan>& spans);
+
+} // namespace calibration
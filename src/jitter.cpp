@@ -0,0 +1,59 @@
+#include "jitter.h"
+
+#include <thread>
+
+#include "scheduler.h"
+
+namespace calibration {
+
+namespace {
+
+class DiscardSink : public FrameSink {
+public:
+    void WriteFrame(const std::wstring&, std::int64_t) override {}
+};
+
+class LatenessObserver : public TickObserver {
+public:
+    explicit LatenessObserver(LatencyHistogram& histogram) : histogram_(histogram) {}
+    void OnTick(const TickInfo& info) override { histogram_.Add(info.lateUs); }
+
+private:
+    LatencyHistogram& histogram_;
+};
+
+void RunPass(const Settings& settings, double seconds, const RealTimeConfig* rt, JitterPass& pass) {
+    SteadyClock clock;
+    DiscardSink sink;
+    LatenessObserver observer(pass.lateness);
+    RunnerCommands commands;
+
+    Engine engine;
+    engine.SetClock(&clock);
+    engine.SetSink(&sink);
+    engine.SetTickObserver(&observer);
+    engine.ReserveFrames(settings.TotalCells());
+    engine.Start(settings, 1);
+
+    // After Start, so the frame buffers have been written and get locked.
+    if (rt) pass.rt = EnterRealTime(*rt);
+    RunRealTime(engine, clock, commands, engine.GetStats().startUs + (std::int64_t)(seconds * 1e6));
+    if (rt) LeaveRealTime(pass.rt);
+
+    engine.Stop();
+    pass.ticks = engine.GetStats().ticks;
+}
+
+} // namespace
+
+JitterReport RunJitterComparison(const Settings& settings, double secondsPerPass, const RealTimeConfig& rt) {
+    Settings s = settings;
+    s.loop = true;
+
+    JitterReport report;
+    std::thread([&] { RunPass(s, secondsPerPass, nullptr, report.normal); }).join();
+    std::thread([&] { RunPass(s, secondsPerPass, &rt, report.realTime); }).join();
+    return report;
+}
+
+} // namespace calibration
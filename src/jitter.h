@@ -0,0 +1,30 @@
+#pragma once
+
+// Tick jitter with and without the real-time setup (rt_thread.h): the same
+// session runs on the wall clock twice, first on an ordinary thread, then on
+// a thread that called EnterRealTime, and the lateness of every tick goes into
+// one histogram per pass. Each pass has a fresh thread, so the first one is
+// not affected by the second's pinning or priority.
+
+#include <cstdint>
+
+#include "calibration_engine.h"
+#include "rt_thread.h"
+#include "soak.h"
+
+namespace calibration {
+
+struct JitterPass {
+    std::uint64_t ticks = 0;
+    LatencyHistogram lateness;      // tick deadline to publish
+    RealTimeStatus rt;              // what the real-time pass was granted
+};
+
+struct JitterReport {
+    JitterPass normal;
+    JitterPass realTime;
+};
+
+JitterReport RunJitterComparison(const Settings& settings, double secondsPerPass, const RealTimeConfig& rt);
+
+} // namespace calibration
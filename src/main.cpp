@@ -2,37 +2,32 @@
 #define NOMINMAX
 #include <windows.h>
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <random>
 #include <algorithm>
 
+#include "calibration_engine.h"
+#include "checkpoint.h"
+#include "metrics.h"
+#include "scheduler.h"
+#include "trace.h"
 #include "resource.h"
 
 namespace {
 
-// Keep combo order == enum order.
-enum class Mode : int {
-    AllDots_RowMajor = 0,
-    AllDots_ColumnMajor = 1,
-    RandomGroupings = 2,
-    DashesCycle_14_25_36_78 = 3,
-
-    Dots78 = 4,
-    Dots1237 = 5,
-    Dots4568 = 6,
-    Alternate1237_4568 = 7,
-
-    Dots1346 = 8,   // mask 0x2D
-    Dots1256 = 9,   // mask 0x33
-    Dots1267 = 10,  // mask 0x63
-    Dots347  = 11,  // mask 0x4C
-    Dots12367 = 12, // mask 0x67
-    Dots12356 = 13, // mask 0x37
-    Dots3678  = 14  // mask 0xE4
-};
+using calibration::Mode;
+using calibration::ModeLabel;
+using calibration::TraceInstant;
+using calibration::TraceSpan;
 
-static std::wstring ModeLabel(Mode m);
+// Writes engine frames into the output control.
+class OutputControlSink : public calibration::FrameSink {
+public:
+    void WriteFrame(const std::wstring& line, std::int64_t timeUs) override;
+};
 
 struct AppState {
     HWND dlg = nullptr;
@@ -45,40 +40,47 @@ struct AppState {
     // Output subclass to catch S and Esc without creating a caret.
     WNDPROC oldOutputProc = nullptr;
 
+    // Interval / Off time edit subclass: Enter applies a typed value.
+    WNDPROC oldTimingEditProc = nullptr;
+
     bool running = false;
     bool paused = false;
     UINT_PTR timerId = 0;
+    bool tickPrepared = false;  // timer is armed for the deadline of a prepared frame
 
     // Optional: stop hotkey while running (S).
     bool hotkeyRegistered = false;
     UINT hotkeyId = 1;
 
-    // Settings
-    int cols = 24;
-    int rows = 4;
-    int intervalMs = 500;
-    Mode mode = Mode::AllDots_RowMajor;
-    bool loop = true;
-    bool wholeLine = false;
+    // Settings (last values read from the dialog)
+    calibration::Settings settings;
 
-    int totalCells = 96; // cols * rows (single long line)
+    calibration::SteadyClock clock;
+    OutputControlSink sink;
+    calibration::Engine engine;
 
-    // Animation state
-    bool phaseOn = true;    // ON -> OFF -> advance
-    int stepIndex = 0;      // 0..totalCells-1
-    int dashSubStep = 0;    // 0..3 for 1-4/2-5/3-6/7-8 cycle
+    std::random_device seedSource;
 
-    std::mt19937 rng{ std::random_device{}() };
+    // Periodic checkpoint of the running session (written on a background
+    // thread); deleted when a run ends normally, offered for resume at startup.
+    std::unique_ptr<calibration::CheckpointWriter> checkpoints;
+    std::int64_t lastCheckpointUs = 0;
+
+    // Optional OpenMetrics export (path in BRAILLE_CALIBRATION_METRICS).
+    calibration::MetricsRegistry metricsRegistry;
+    calibration::SessionMetrics metrics{ "dialog" };
+    std::unique_ptr<calibration::MetricsFileExporter> metricsExporter;
 };
 
 AppState g;
 
-constexpr wchar_t kBrailleBlank = 0x2800;
-
 #ifndef MOD_NOREPEAT
 #define MOD_NOREPEAT 0x4000
 #endif
 
+constexpr std::int64_t kCheckpointEveryUs = 30LL * 1000000;
+constexpr std::int64_t kMetricsEveryMs = 10000;
+
 static void SetStatus(const std::wstring& s) {
     if (g.status) SetWindowTextW(g.status, s.c_str());
 }
@@ -115,22 +117,35 @@ static std::wstring FormatCounts(int cols, int rows) {
     return s;
 }
 
+static void SetRunningStatus() {
+    std::wstring status = L"Status: Running. ";
+    status += ModeLabel(g.settings.mode);
+    status += L". ";
+    status += FormatCounts(g.settings.cols, g.settings.rows);
+    status += L" Interval: ";
+    status += std::to_wstring(g.settings.intervalMs);
+    status += L" ms, off ";
+    status += std::to_wstring(g.settings.OffDurationMs());
+    status += L" ms. ";
+
+    status += g.settings.wholeLine ? L"Blink whole line: ON. " : L"Blink whole line: OFF (walking). ";
+    status += L"Pause: P or Enter. Stop: Esc or S.";
+
+    SetStatus(status);
+}
+
 static void EnableRunningUi(HWND dlg, bool running) {
     EnableWindow(GetDlgItem(dlg, IDC_START), running ? FALSE : TRUE);
     EnableWindow(GetDlgItem(dlg, IDC_STOP),  running ? TRUE : FALSE);
 
+    // Geometry is fixed for a run; timing, mode and loop can change live.
     EnableWindow(GetDlgItem(dlg, IDC_COLUMNS),  running ? FALSE : TRUE);
     EnableWindow(GetDlgItem(dlg, IDC_ROWS),     running ? FALSE : TRUE);
-    EnableWindow(GetDlgItem(dlg, IDC_INTERVAL), running ? FALSE : TRUE);
-    EnableWindow(GetDlgItem(dlg, IDC_MODE),     running ? FALSE : TRUE);
-    EnableWindow(GetDlgItem(dlg, IDC_LOOP),     running ? FALSE : TRUE);
-
-    if (g.chkWholeLine) {
-    EnableWindow(GetDlgItem(dlg, IDC_WHOLELINE), running ? FALSE : TRUE);
-    }
 }
 
 static void NotifyOutputChanged(HWND hwnd) {
+    TraceSpan span("notify accessibility");
+
     // Encourage screen readers to notice updates.
     NotifyWinEvent(EVENT_OBJECT_NAMECHANGE, hwnd, OBJID_CLIENT, CHILDID_SELF);
     NotifyWinEvent(EVENT_OBJECT_VALUECHANGE, hwnd, OBJID_CLIENT, CHILDID_SELF);
@@ -138,190 +153,102 @@ static void NotifyOutputChanged(HWND hwnd) {
 
 static void SetOutputText(const std::wstring& s) {
     if (!g.output) return;
-    SetWindowTextW(g.output, s.c_str());
+    {
+        TraceSpan span("SetWindowText");
+        SetWindowTextW(g.output, s.c_str());
+    }
     NotifyOutputChanged(g.output);
 }
 
-static wchar_t MaskToBrailleCell(unsigned char mask) {
-    return (wchar_t)(0x2800 + (wchar_t)mask);
+void OutputControlSink::WriteFrame(const std::wstring& line, std::int64_t) {
+    SetOutputText(line);
 }
 
-static bool IsColumnMajorMode(Mode m) {
-    return m == Mode::AllDots_ColumnMajor;
+static bool ArmTimerAt(HWND dlg, std::int64_t targetUs) {
+    const std::int64_t delayUs = targetUs - g.clock.NowUs();
+    const UINT delayMs = (delayUs > 1000) ? (UINT)(delayUs / 1000) : 1;
+    g.timerId = SetTimer(dlg, 1, delayMs, nullptr);
+    return g.timerId != 0;
 }
 
-static bool IsRandomMode(Mode m) {
-    return m == Mode::RandomGroupings;
+// Arms the tick timer for the engine's next wake time: the absolute deadline
+// minus the estimated build + output cost, so timer jitter does not accumulate.
+// The wake builds the frame (PrepareTick); it goes out at the deadline.
+static bool ArmTickTimer(HWND dlg) {
+    g.tickPrepared = false;
+    return ArmTimerAt(dlg, g.engine.NextWakeUs());
 }
 
-static bool IsDashCycleMode(Mode m) {
-    return m == Mode::DashesCycle_14_25_36_78;
-}
-
-static bool IsAlternateMode(Mode m) {
-    return m == Mode::Alternate1237_4568;
+static void UnregisterStopHotkey(HWND dlg) {
+    if (!g.hotkeyRegistered) return;
+    UnregisterHotKey(dlg, g.hotkeyId);
+    g.hotkeyRegistered = false;
 }
 
-static unsigned char FixedMaskForMode(Mode m) {
-    switch (m) {
-    case Mode::AllDots_RowMajor:
-    case Mode::AllDots_ColumnMajor:
-        return 0xFF;
-
-    case Mode::Dots78:   return 0xC0;
-    case Mode::Dots1237: return 0x47;
-    case Mode::Dots4568: return 0xB8;
-
-    case Mode::Dots1346:  return 0x2D;
-    case Mode::Dots1256:  return 0x33;
-    case Mode::Dots1267:  return 0x63;
-    case Mode::Dots347:   return 0x4C;
-    case Mode::Dots12367: return 0x67;
-    case Mode::Dots12356: return 0x37;
-    case Mode::Dots3678:  return 0xE4;
+static void RegisterStopHotkey(HWND dlg) {
+    if (g.hotkeyRegistered) return;
 
-    default:
-        return 0x00;
+    // While running, only numeric fields, the mode list and checkboxes are
+    // editable, none of which need S, so grabbing it is safe.
+    if (RegisterHotKey(dlg, g.hotkeyId, MOD_NOREPEAT, 'S')) {
+        g.hotkeyRegistered = true;
     }
 }
 
-static wchar_t DashCycleCell(int subStep) {
-    // Cycle: dots 1-4, 2-5, 3-6, 7-8
-    // bit 0..7 == dot 1..8
-    static const unsigned char masks[4] = {
-        0x09, // 1 + 4
-        0x12, // 2 + 5
-        0x24, // 3 + 6
-        0xC0  // 7 + 8
-    };
-    return MaskToBrailleCell(masks[subStep & 3]);
-}
-
-static std::wstring BuildBlankLine() {
-    return std::wstring((size_t)g.totalCells, kBrailleBlank);
+// Engine-clock time at which the message being processed was posted.
+// GetMessageTime has millisecond resolution, which is enough for key latency.
+static std::int64_t CurrentMessageTimeUs() {
+    const DWORD ageMs = GetTickCount() - (DWORD)GetMessageTime();
+    return g.clock.NowUs() - 1000LL * (std::int64_t)ageMs;
 }
 
-static int MapStepToCellIndex(int stepIndex) {
-    if (!IsColumnMajorMode(g.mode)) return stepIndex;
+// %LOCALAPPDATA%\BrailleDisplayCalibrationTool\checkpoint.txt, or empty if unavailable.
+static std::wstring CheckpointPath() {
+    wchar_t base[MAX_PATH] = {};
+    const DWORD n = GetEnvironmentVariableW(L"LOCALAPPDATA", base, MAX_PATH);
+    if (n == 0 || n >= MAX_PATH) return std::wstring();
 
-    // Column-major order over a virtual grid:
-    // for col in 0..cols-1:
-    //   for row in 0..rows-1:
-    //      index = row*cols + col
-    int col = stepIndex / g.rows;
-    int row = stepIndex % g.rows;
-
-    if (col < 0) col = 0;
-    if (col >= g.cols) col = g.cols - 1;
-    if (row < 0) row = 0;
-    if (row >= g.rows) row = g.rows - 1;
-
-    return row * g.cols + col;
+    std::wstring dir = base;
+    dir += L"\\BrailleDisplayCalibrationTool";
+    CreateDirectoryW(dir.c_str(), nullptr); // fails harmlessly if it exists
+    return dir + L"\\checkpoint.txt";
 }
 
-static std::wstring BuildLineForTick() {
-    std::wstring line = BuildBlankLine();
-    if (g.totalCells <= 0) return line;
-
-    // Random mode is special:
-    if (IsRandomMode(g.mode)) {
-        // If "Blink whole line" is checked, we treat it literally:
-        // ON phase: every cell gets a random non-zero mask
-        // OFF phase: blank line
-        if (g.wholeLine) {
-            if (!g.phaseOn) return line;
-            std::uniform_int_distribution<int> dist(1, 255);
-            for (int i = 0; i < g.totalCells; ++i) {
-                unsigned char mask = (unsigned char)dist(g.rng);
-                line[(size_t)i] = MaskToBrailleCell(mask);
-            }
-            return line;
-        }
-
-        // Otherwise, "groupings": sprinkle random patterns across the line, no forced blank phase.
-        std::uniform_real_distribution<double> chance(0.0, 1.0);
-        std::uniform_int_distribution<int> dist(1, 255);
-
-        const double fillProb = 0.35;
-        for (int i = 0; i < g.totalCells; ++i) {
-            if (chance(g.rng) <= fillProb) {
-                unsigned char mask = (unsigned char)dist(g.rng);
-                line[(size_t)i] = MaskToBrailleCell(mask);
-            }
-        }
-        return line;
-    }
-
-    // Whole-line blink mode (applies to every non-random mode)
-    if (g.wholeLine) {
-        if (!g.phaseOn) return line;
-
-        if (IsDashCycleMode(g.mode)) {
-            const wchar_t cell = DashCycleCell(g.dashSubStep);
-            std::fill(line.begin(), line.end(), cell);
-            return line;
-        }
-
-        if (IsAlternateMode(g.mode)) {
-            const wchar_t a = MaskToBrailleCell(0x47); // 1237
-            const wchar_t b = MaskToBrailleCell(0xB8); // 4568
-            for (size_t i = 0; i < line.size(); ++i) {
-                line[i] = (i % 2 == 0) ? a : b;
-            }
-            return line;
-        }
-
-        // Fixed mask
-        unsigned char mask = FixedMaskForMode(g.mode);
-        if (mask == 0x00) mask = 0xFF;
-        std::fill(line.begin(), line.end(), MaskToBrailleCell(mask));
-        return line;
-    }
-
-    // Walking mode (default): one active cell blinks at a time.
-    const int cellIndex = MapStepToCellIndex(g.stepIndex);
-    if (cellIndex < 0 || cellIndex >= g.totalCells) return line;
-
-    if (!g.phaseOn) {
-        return line; // OFF phase: blank line
-    }
-
-    if (IsDashCycleMode(g.mode)) {
-        line[(size_t)cellIndex] = DashCycleCell(g.dashSubStep);
-        return line;
-    }
-
-    if (IsAlternateMode(g.mode)) {
-        // Alternate pattern based on *actual* cell index parity.
-        const unsigned char mask = ((cellIndex % 2) == 0) ? 0x47 : 0xB8;
-        line[(size_t)cellIndex] = MaskToBrailleCell(mask);
-        return line;
-    }
+// Counters are updated by the engine on the UI thread; the file is rewritten
+// by the exporter's own thread.
+static void StartMetricsExport() {
+    wchar_t path[MAX_PATH] = {};
+    const DWORD n = GetEnvironmentVariableW(L"BRAILLE_CALIBRATION_METRICS", path, MAX_PATH);
+    if (n == 0 || n >= MAX_PATH) return;
 
-    unsigned char mask = FixedMaskForMode(g.mode);
-    if (mask == 0x00) mask = 0xFF;
-    line[(size_t)cellIndex] = MaskToBrailleCell(mask);
-    return line;
+    g.engine.SetMetrics(&g.metrics);
+    g.metricsRegistry.Add(&g.metrics);
+    g.metricsExporter.reset(new calibration::MetricsFileExporter(g.metricsRegistry, path, kMetricsEveryMs));
 }
 
-static void UnregisterStopHotkey(HWND dlg) {
-    if (!g.hotkeyRegistered) return;
-    UnregisterHotKey(dlg, g.hotkeyId);
-    g.hotkeyRegistered = false;
-}
+// Called after a tick; only copies the snapshot, the write happens elsewhere.
+static void MaybeCheckpoint() {
+    if (!g.checkpoints) return;
 
-static void RegisterStopHotkey(HWND dlg) {
-    if (g.hotkeyRegistered) return;
+    const std::int64_t now = g.clock.NowUs();
+    if (now - g.lastCheckpointUs < kCheckpointEveryUs) return;
 
-    // While running, config fields are disabled, so grabbing S is safe.
-    if (RegisterHotKey(dlg, g.hotkeyId, MOD_NOREPEAT, 'S')) {
-        g.hotkeyRegistered = true;
-    }
+    g.checkpoints->Submit(g.engine.Snapshot());
+    g.lastCheckpointUs = now;
 }
 
-static void StopCalibration(HWND dlg) {
+// requestedAtUs: when the operator asked for the stop (key press), or -1.
+static void StopCalibration(HWND dlg, std::int64_t requestedAtUs = -1) {
     if (!g.running) return;
 
+    // Blank output first, before any UI work (no-op if the engine already
+    // finished the pass itself). Any WM_TIMER still queued is ignored below
+    // because g.running is cleared.
+    g.engine.Stop(requestedAtUs);
+
+    // The run ended on purpose (or finished), so there is nothing to resume.
+    if (g.checkpoints) g.checkpoints->Clear();
+
     if (g.timerId) {
         KillTimer(dlg, g.timerId);
         g.timerId = 0;
@@ -333,14 +260,25 @@ static void StopCalibration(HWND dlg) {
     g.paused = false;
     EnableRunningUi(dlg, false);
 
-    // Blank output
-    SetOutputText(BuildBlankLine());
-
     // Put focus back into the main control list
     HWND modeCombo = GetDlgItem(dlg, IDC_MODE);
     if (modeCombo) SetFocus(modeCombo);
 
-    SetStatus(L"Status: Idle. (Esc exits when idle. While running: P/Enter pauses; Esc or S stops.)");
+    std::wstring status = L"Status: Idle. Last run: ";
+    status += std::to_wstring(g.engine.GetStats().framesWritten);
+    status += L" frames written, ";
+    status += std::to_wstring(g.engine.GetStats().framesSkipped);
+    status += L" unchanged frames skipped.";
+    if (g.engine.GetStats().stopLatencyUs >= 0) {
+        const std::int64_t us = g.engine.GetStats().stopLatencyUs;
+        status += L" Stop latency: ";
+        status += std::to_wstring(us / 1000);
+        status += L".";
+        status += std::to_wstring((us / 100) % 10);
+        status += L" ms.";
+    }
+    status += L" (Esc exits when idle. While running: P/Enter pauses; Esc or S stops.)";
+    SetStatus(status);
 }
 
 
@@ -348,8 +286,11 @@ static void TogglePause(HWND dlg) {
     if (!g.running) return;
 
     if (!g.paused) {
-        // Pause
+        // Pause: takes effect at once; a frame prepared for the next tick is dropped
+        // and any WM_TIMER already queued is ignored. The current cell stays up so
+        // it can be inspected.
         g.paused = true;
+        g.engine.SetPaused(true);
 
         if (g.timerId) {
             KillTimer(dlg, g.timerId);
@@ -357,18 +298,18 @@ static void TogglePause(HWND dlg) {
         }
 
         std::wstring status = L"Status: Paused. ";
-        status += ModeLabel(g.mode);
+        status += ModeLabel(g.settings.mode);
         status += L". ";
-        status += FormatCounts(g.cols, g.rows);
+        status += FormatCounts(g.settings.cols, g.settings.rows);
         status += L" Resume: P or Enter. Stop: Esc or S.";
         SetStatus(status);
     } else {
         // Resume
         g.paused = false;
+        g.engine.SetPaused(false);
 
         if (!g.timerId) {
-            g.timerId = SetTimer(dlg, 1, (UINT)g.intervalMs, nullptr);
-            if (!g.timerId) {
+            if (!ArmTickTimer(dlg)) {
                 ShowError(dlg, L"Failed to resume timer.");
                 StopCalibration(dlg);
                 return;
@@ -378,73 +319,12 @@ static void TogglePause(HWND dlg) {
         // Keep focus on the output area so key controls work consistently.
         if (g.output) SetFocus(g.output);
 
-        std::wstring status = L"Status: Running. ";
-        status += ModeLabel(g.mode);
-        status += L". ";
-        status += FormatCounts(g.cols, g.rows);
-        status += L" Interval: ";
-        status += std::to_wstring(g.intervalMs);
-        status += L" ms. ";
-        status += g.wholeLine ? L"Blink whole line: ON. " : L"Blink whole line: OFF (walking). ";
-        status += L"Pause: P or Enter. Stop: Esc or S.";
-        SetStatus(status);
-    }
-}
-
-static void AdvanceState(HWND dlg) {
-    // Random groupings (non-whole-line) just keeps updating; no on/off stepping.
-    if (IsRandomMode(g.mode) && !g.wholeLine) return;
-
-    // For all other situations, we blink ON/OFF.
-    if (g.phaseOn) {
-        g.phaseOn = false;
-        return;
-    }
-
-    // OFF -> ON (this is where we advance the walk/cycle)
-    g.phaseOn = true;
-
-    if (g.wholeLine) {
-        // Whole-line: there is no walk. Only dashes has an internal cycle worth advancing.
-        if (IsDashCycleMode(g.mode)) {
-            g.dashSubStep++;
-            if (g.dashSubStep >= 4) {
-                g.dashSubStep = 0;
-                if (!g.loop) {
-                    StopCalibration(dlg);
-                }
-            }
-        } else {
-            // For whole-line blink, if loop is off, one blink cycle is enough.
-            if (!g.loop) {
-                StopCalibration(dlg);
-            }
-        }
-        return;
-    }
-
-    // Walking mode: advance cell position (and dash substep if needed).
-    if (IsDashCycleMode(g.mode)) {
-        g.dashSubStep++;
-        if (g.dashSubStep >= 4) {
-            g.dashSubStep = 0;
-            g.stepIndex++;
-        }
-    } else {
-        g.stepIndex++;
-    }
-
-    if (g.stepIndex >= g.totalCells) {
-        if (g.loop) {
-            g.stepIndex = 0;
-        } else {
-            StopCalibration(dlg);
-        }
+        SetRunningStatus();
     }
 }
 
 static bool ReadSettingsFromDialog(HWND dlg) {
-    int cols = 0, rows = 0, intervalMs = 0;
+    int cols = 0, rows = 0, intervalMs = 0, offMs = 0;
 
     if (!ReadInt(dlg, IDC_COLUMNS, cols) || cols <= 0) {
         ShowError(dlg, L"Columns must be a positive number.");
@@ -458,6 +338,10 @@ static bool ReadSettingsFromDialog(HWND dlg) {
         ShowError(dlg, L"Interval must be a positive number of milliseconds.");
         return false;
     }
+    if (!ReadInt(dlg, IDC_OFFTIME, offMs)) {
+        ShowError(dlg, L"Off time must be a number of milliseconds (0 for no blank phase).");
+        return false;
+    }
 
     long long totalCells = 1LL * cols * rows;
     if (totalCells <= 0 || totalCells > 5000) {
@@ -469,44 +353,55 @@ static bool ReadSettingsFromDialog(HWND dlg) {
     int sel = (hMode ? (int)SendMessageW(hMode, CB_GETCURSEL, 0, 0) : 0);
     if (sel < 0) sel = 0;
 
-    g.cols = cols;
-    g.rows = rows;
-    g.intervalMs = intervalMs;
-    g.loop = (IsDlgButtonChecked(dlg, IDC_LOOP) == BST_CHECKED);
-    g.mode = (Mode)sel;
-    g.totalCells = (int)totalCells;
+    g.settings.cols = cols;
+    g.settings.rows = rows;
+    g.settings.intervalMs = intervalMs;
+    g.settings.offMs = offMs;
+    g.settings.loop = (IsDlgButtonChecked(dlg, IDC_LOOP) == BST_CHECKED);
+    g.settings.mode = (Mode)sel;
 
     if (g.chkWholeLine) {
 
-    g.wholeLine = (IsDlgButtonChecked(dlg, IDC_WHOLELINE) == BST_CHECKED);
+    g.settings.wholeLine = (IsDlgButtonChecked(dlg, IDC_WHOLELINE) == BST_CHECKED);
     } else {
-        g.wholeLine = false;
+        g.settings.wholeLine = false;
     }
 
     return true;
 }
 
-static std::wstring ModeLabel(Mode m) {
-    switch (m) {
-    case Mode::AllDots_RowMajor: return L"All dots (1-8), row-major walk";
-    case Mode::AllDots_ColumnMajor: return L"All dots (1-8), column-major walk";
-    case Mode::RandomGroupings: return L"Random dot groupings";
-    case Mode::DashesCycle_14_25_36_78: return L"Dashes cycle (1-4 / 2-5 / 3-6 / 7-8)";
-
-    case Mode::Dots78: return L"Dots 7-8";
-    case Mode::Dots1237: return L"Dots 1-2-3-7";
-    case Mode::Dots4568: return L"Dots 4-5-6-8";
-    case Mode::Alternate1237_4568: return L"Alternating 1237 / 4568";
-
-    case Mode::Dots1346: return L"Dots 1-3-4-6";
-    case Mode::Dots1256: return L"Dots 1-2-5-6";
-    case Mode::Dots1267: return L"Dots 1-2-6-7";
-    case Mode::Dots347:  return L"Dots 3-4-7";
-    case Mode::Dots12367:return L"Dots 1-2-3-6-7";
-    case Mode::Dots12356:return L"Dots 1-2-3-5-6";
-    case Mode::Dots3678: return L"Dots 3-6-7-8";
-    default: return L"(unknown)";
-    }
+// Reads the settings that may change mid-run, without error boxes: fields are
+// often briefly invalid while being edited (e.g. empty), which just means
+// "not yet". Geometry comes from the running settings.
+static bool ReadLiveSettings(HWND dlg, calibration::Settings& out) {
+    int intervalMs = 0, offMs = 0;
+    if (!ReadInt(dlg, IDC_INTERVAL, intervalMs) || intervalMs <= 0) return false;
+    if (!ReadInt(dlg, IDC_OFFTIME, offMs)) return false;
+
+    HWND hMode = GetDlgItem(dlg, IDC_MODE);
+    int sel = (hMode ? (int)SendMessageW(hMode, CB_GETCURSEL, 0, 0) : 0);
+    if (sel < 0) sel = 0;
+
+    out = g.settings;
+    out.intervalMs = intervalMs;
+    out.offMs = offMs;
+    out.mode = (Mode)sel;
+    out.loop = (IsDlgButtonChecked(dlg, IDC_LOOP) == BST_CHECKED);
+    out.wholeLine = g.chkWholeLine && (IsDlgButtonChecked(dlg, IDC_WHOLELINE) == BST_CHECKED);
+    return true;
+}
+
+// Applies a settings change made while running. The engine picks it up at the
+// next tick boundary and keeps the current cell.
+static void ApplyLiveSettings(HWND dlg) {
+    if (!g.running) return;
+
+    calibration::Settings next;
+    if (!ReadLiveSettings(dlg, next)) return;
+
+    g.settings = next;
+    g.engine.Reconfigure(next);
+    if (!g.paused) SetRunningStatus();
 }
 
 // Output control: focusable static, no caret.
@@ -522,8 +417,10 @@ static LRESULT CALLBACK OutputProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
         return 0;
 
     case WM_KEYDOWN:
+        // Stop keys are handled right here rather than posted back to the dialog,
+        // so the blank line goes out before anything else in the queue.
         if (g.running && wParam == VK_ESCAPE) {
-            PostMessageW(GetParent(hwnd), WM_COMMAND, MAKEWPARAM(IDCANCEL, 0), 0);
+            StopCalibration(GetParent(hwnd), CurrentMessageTimeUs());
             return 0;
         }
         break;
@@ -533,7 +430,7 @@ static LRESULT CALLBACK OutputProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
             wchar_t ch = (wchar_t)wParam;
 
             if (ch == L's' || ch == L'S') {
-                PostMessageW(GetParent(hwnd), WM_COMMAND, MAKEWPARAM(IDC_STOP, 0), 0);
+                StopCalibration(GetParent(hwnd), CurrentMessageTimeUs());
                 return 0;
             }
 
@@ -554,6 +451,50 @@ static LRESULT CALLBACK OutputProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lP
         : DefWindowProcW(hwnd, msg, wParam, lParam);
 }
 
+// Interval and Off time edits. While running, a typed value goes to the engine
+// on Enter or when the edit loses focus, never per keystroke: typing "1000"
+// must not run the walk at 1, 10 and 100 ms on the way.
+static LRESULT CALLBACK TimingEditProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    switch (msg) {
+    case WM_GETDLGCODE: {
+        // Keep Enter from reaching the default (Close) button while running.
+        const MSG* m = (const MSG*)lParam;
+        if (g.running && m && m->message == WM_KEYDOWN && m->wParam == VK_RETURN) {
+            return DLGC_WANTMESSAGE;
+        }
+        break;
+    }
+
+    case WM_KEYDOWN:
+        if (g.running && wParam == VK_RETURN) {
+            ApplyLiveSettings(GetParent(hwnd));
+            return 0;
+        }
+        break;
+
+    case WM_CHAR:
+        if (g.running && wParam == L'\r') return 0; // no beep
+        break;
+
+    default:
+        break;
+    }
+
+    return g.oldTimingEditProc
+        ? CallWindowProcW(g.oldTimingEditProc, hwnd, msg, wParam, lParam)
+        : DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+static void SubclassTimingEdits(HWND dlg) {
+    const int ids[2] = { IDC_INTERVAL, IDC_OFFTIME };
+    for (int id : ids) {
+        HWND edit = GetDlgItem(dlg, id);
+        if (!edit) continue;
+        const WNDPROC old = (WNDPROC)SetWindowLongPtrW(edit, GWLP_WNDPROC, (LONG_PTR)TimingEditProc);
+        if (!g.oldTimingEditProc) g.oldTimingEditProc = old; // both are EDIT controls
+    }
+}
+
 static void ReplaceOutputEditWithStatic(HWND dlg) {
     HWND old = GetDlgItem(dlg, IDC_OUTPUT);
     if (!old) return;
@@ -642,40 +583,81 @@ static void StartCalibration(HWND dlg) {
     if (g.running) return;
     if (!ReadSettingsFromDialog(dlg)) return;
 
-    g.phaseOn = true;
-    g.stepIndex = 0;
-    g.dashSubStep = 0;
     g.paused = false;
 
     // Focus output so braille tends to follow it.
     if (g.output) SetFocus(g.output);
 
-    // First frame immediately
-    SetOutputText(BuildLineForTick());
+    // Resets the walk and publishes the first frame immediately.
+    g.engine.Start(g.settings, g.seedSource());
 
-    g.timerId = SetTimer(dlg, 1, (UINT)g.intervalMs, nullptr);
-    if (!g.timerId) {
+    if (!ArmTickTimer(dlg)) {
         ShowError(dlg, L"Failed to start timer.");
-        StopCalibration(dlg);
+        g.engine.Stop();
         return;
     }
 
     g.running = true;
+    g.lastCheckpointUs = g.clock.NowUs();
     EnableRunningUi(dlg, true);
     RegisterStopHotkey(dlg);
 
-    std::wstring status = L"Status: Running. ";
-    status += ModeLabel(g.mode);
-    status += L". ";
-    status += FormatCounts(g.cols, g.rows);
-    status += L" Interval: ";
-    status += std::to_wstring(g.intervalMs);
-    status += L" ms. ";
+    SetRunningStatus();
+}
 
-    status += g.wholeLine ? L"Blink whole line: ON. " : L"Blink whole line: OFF (walking). ";
-    status += L"Pause: P or Enter. Stop: Esc or S.";
+// Offers to continue a run that was interrupted (crash, power loss, logoff).
+// The run picks up at the saved tick with the saved line back on the display.
+static void OfferResume(HWND dlg) {
+    if (!g.checkpoints) return;
+
+    calibration::EngineSnapshot snap;
+    if (!calibration::LoadCheckpoint(g.checkpoints->Path(), snap)) return;
+
+    const std::int64_t minutes = snap.elapsedUs / 60000000;
+    std::wstring prompt = L"An interrupted calibration run was found: ";
+    prompt += ModeLabel(snap.LatestSettings().mode);
+    prompt += L", ";
+    prompt += FormatCounts(snap.settings.cols, snap.settings.rows);
+    prompt += L" Stopped after ";
+    prompt += std::to_wstring(snap.ticks);
+    prompt += L" ticks (";
+    prompt += std::to_wstring(minutes);
+    prompt += L" min).\n\nResume it?";
+
+    if (MessageBoxW(dlg, prompt.c_str(), L"Braille Display Calibration Tool",
+                    MB_ICONQUESTION | MB_YESNO) != IDYES) {
+        g.checkpoints->Clear();
+        return;
+    }
 
-    SetStatus(status);
+    // Show the resumed settings in the dialog so live changes start from them.
+    g.settings = snap.LatestSettings();
+    SetDlgItemInt(dlg, IDC_COLUMNS, g.settings.cols, FALSE);
+    SetDlgItemInt(dlg, IDC_ROWS, g.settings.rows, FALSE);
+    SetDlgItemInt(dlg, IDC_INTERVAL, g.settings.intervalMs, FALSE);
+    SetDlgItemInt(dlg, IDC_OFFTIME, g.settings.OffDurationMs(), FALSE);
+    HWND hMode = GetDlgItem(dlg, IDC_MODE);
+    if (hMode) SendMessageW(hMode, CB_SETCURSEL, (WPARAM)g.settings.mode, 0);
+    CheckDlgButton(dlg, IDC_LOOP, g.settings.loop ? BST_CHECKED : BST_UNCHECKED);
+    CheckDlgButton(dlg, IDC_WHOLELINE, g.settings.wholeLine ? BST_CHECKED : BST_UNCHECKED);
+
+    g.paused = false;
+    if (g.output) SetFocus(g.output);
+
+    g.engine.Resume(snap);
+
+    if (!ArmTickTimer(dlg)) {
+        ShowError(dlg, L"Failed to start timer.");
+        g.engine.Stop();
+        return;
+    }
+
+    g.running = true;
+    g.lastCheckpointUs = g.clock.NowUs();
+    EnableRunningUi(dlg, true);
+    RegisterStopHotkey(dlg);
+
+    SetRunningStatus();
 }
 
 INT_PTR CALLBACK MainDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam) {
@@ -686,10 +668,17 @@ INT_PTR CALLBACK MainDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam) {
 
         ReplaceOutputEditWithStatic(dlg);
     CreateWholeLineCheckbox(dlg); 
+        SubclassTimingEdits(dlg);
+
+        g.engine.SetClock(&g.clock);
+        g.engine.SetSink(&g.sink);
+        StartMetricsExport();
+
         // Defaults
-        SetDlgItemInt(dlg, IDC_COLUMNS, g.cols, FALSE);
-        SetDlgItemInt(dlg, IDC_ROWS, g.rows, FALSE);
-        SetDlgItemInt(dlg, IDC_INTERVAL, g.intervalMs, FALSE);
+        SetDlgItemInt(dlg, IDC_COLUMNS, g.settings.cols, FALSE);
+        SetDlgItemInt(dlg, IDC_ROWS, g.settings.rows, FALSE);
+        SetDlgItemInt(dlg, IDC_INTERVAL, g.settings.intervalMs, FALSE);
+        SetDlgItemInt(dlg, IDC_OFFTIME, g.settings.OffDurationMs(), FALSE);
         CheckDlgButton(dlg, IDC_LOOP, BST_CHECKED);
 
         // Populate mode list (no "whole line" items anymore)
@@ -718,25 +707,61 @@ INT_PTR CALLBACK MainDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam) {
 
         EnableRunningUi(dlg, false);
 
-        g.totalCells = g.cols * g.rows;
-        SetOutputText(BuildBlankLine());
+        SetOutputText(std::wstring((size_t)g.settings.TotalCells(), calibration::kBrailleBlank));
 
         SetStatus(L"Status: Idle. Tip: set translation to 8-dot Computer Braille. While running: P or Enter pauses; Esc or S stops.");
+
+        const std::wstring checkpointPath = CheckpointPath();
+        if (!checkpointPath.empty()) {
+            g.checkpoints.reset(new calibration::CheckpointWriter(checkpointPath));
+            OfferResume(dlg);
+        }
         return TRUE;
     }
 
     case WM_TIMER:
         if (wParam == 1 && g.running) {
+            TraceInstant("WM_TIMER");
             if (g.paused) return TRUE;
-            SetOutputText(BuildLineForTick());
-            AdvanceState(dlg);
+
+            if (!g.tickPrepared) {
+                // Wake: build the next frame now and publish it at its deadline.
+                g.engine.PrepareTick();
+                g.tickPrepared = true;
+                if (g.engine.NextTickUs() - g.clock.NowUs() > 1000LL * USER_TIMER_MINIMUM) {
+                    if (!ArmTimerAt(dlg, g.engine.NextTickUs())) {
+                        ShowError(dlg, L"Failed to re-arm timer.");
+                        StopCalibration(dlg);
+                    }
+                    return TRUE;
+                }
+                // Closer than WM_TIMER can resolve: wait out the rest here.
+                calibration::SleepUntilUs(g.clock, g.engine.NextTickUs());
+            }
+            g.engine.Tick();
+
+            // Loop off: the engine ends the pass itself (and blanks the line).
+            if (!g.engine.Running()) {
+                StopCalibration(dlg);
+                return TRUE;
+            }
+
+            // Each phase has its own duration; re-arm for the next wake.
+            if (!ArmTickTimer(dlg)) {
+                ShowError(dlg, L"Failed to re-arm timer.");
+                StopCalibration(dlg);
+                return TRUE;
+            }
+
+            // After re-arming, so the snapshot copy never delays the next tick.
+            MaybeCheckpoint();
             return TRUE;
         }
         return FALSE;
 
     case WM_HOTKEY:
         if (g.running && (UINT)wParam == g.hotkeyId) {
-            StopCalibration(dlg);
+            StopCalibration(dlg, CurrentMessageTimeUs());
             return TRUE;
         }
         return FALSE;
@@ -750,13 +775,31 @@ INT_PTR CALLBACK MainDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam) {
             return TRUE;
 
         case IDC_STOP:
-            StopCalibration(dlg);
+            StopCalibration(dlg, CurrentMessageTimeUs());
+            return TRUE;
+
+        case IDC_INTERVAL:
+        case IDC_OFFTIME:
+            // Not on EN_CHANGE: a half-typed value would reach the engine.
+            if (HIWORD(wParam) != EN_KILLFOCUS) return FALSE;
+            ApplyLiveSettings(dlg);
+            return TRUE;
+
+        case IDC_MODE:
+            if (HIWORD(wParam) != CBN_SELCHANGE) return FALSE;
+            ApplyLiveSettings(dlg);
+            return TRUE;
+
+        case IDC_LOOP:
+        case IDC_WHOLELINE:
+            if (HIWORD(wParam) != BN_CLICKED) return FALSE;
+            ApplyLiveSettings(dlg);
             return TRUE;
 
         case IDCANCEL:
             // Esc while running should STOP, not exit.
             if (g.running) {
-                StopCalibration(dlg);
+                StopCalibration(dlg, CurrentMessageTimeUs());
                 return TRUE;
             }
             EndDialog(dlg, 0);
@@ -783,5 +826,21 @@ INT_PTR CALLBACK MainDlgProc(HWND dlg, UINT msg, WPARAM wParam, LPARAM lParam) {
 } // namespace
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE, PWSTR, int) {
-    return (int)DialogBoxParamW(hInstance, MAKEINTRESOURCEW(IDD_MAIN), nullptr, MainDlgProc, 0);
+    // Optional tick-pipeline trace, written when the app exits.
+    wchar_t tracePath[MAX_PATH] = {};
+    const DWORD traceLen = GetEnvironmentVariableW(L"BRAILLE_CALIBRATION_TRACE", tracePath, MAX_PATH);
+    const bool trace = (traceLen > 0 && traceLen < MAX_PATH);
+    if (trace) {
+        calibration::EnableTrace(true);
+        calibration::SetTraceThreadName("UI");
+    }
+
+    const int result = (int)DialogBoxParamW(hInstance, MAKEINTRESOURCEW(IDD_MAIN), nullptr, MainDlgProc, 0);
+
+    // Finish any pending checkpoint write and the last metrics file before the process exits.
+    g.checkpoints.reset();
+    g.metricsExporter.reset();
+
+    if (trace) calibration::WriteChromeTrace(tracePath);
+    return result;
 }
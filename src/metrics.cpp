@@ -0,0 +1,152 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include "checkpoint.h"
+
+namespace calibration {
+
+namespace {
+
+constexpr const char* kPrefix = "braille_calibration_";
+
+std::string Label(const SessionMetrics& s) {
+    std::string out = "session=\"";
+    for (char c : s.name) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    out += '"';
+    return out;
+}
+
+std::string Seconds(double us) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", us / 1e6);
+    return buf;
+}
+
+void Family(std::string& out, const char* name, const char* type, const char* help, bool seconds = false) {
+    out += "# TYPE "; out += kPrefix; out += name; out += ' '; out += type; out += '\n';
+    if (seconds) { out += "# UNIT "; out += kPrefix; out += name; out += " seconds\n"; }
+    out += "# HELP "; out += kPrefix; out += name; out += ' '; out += help; out += '\n';
+}
+
+void Sample(std::string& out, const char* name, const char* suffix, const std::string& labels,
+            const std::string& value) {
+    out += kPrefix; out += name; out += suffix;
+    out += '{'; out += labels; out += "} ";
+    out += value;
+    out += '\n';
+}
+
+using Sessions = std::vector<const SessionMetrics*>;
+
+void Counter(std::string& out, const Sessions& sessions, const char* name, const char* help,
+             std::atomic<std::uint64_t> SessionMetrics::*field) {
+    Family(out, name, "counter", help);
+    for (const SessionMetrics* s : sessions) {
+        Sample(out, name, "_total", Label(*s), std::to_string((s->*field).load(std::memory_order_relaxed)));
+    }
+}
+
+void Gauge(std::string& out, const Sessions& sessions, const char* name, const char* help,
+           std::atomic<std::int64_t> SessionMetrics::*field) {
+    Family(out, name, "gauge", help);
+    for (const SessionMetrics* s : sessions) {
+        Sample(out, name, "", Label(*s), std::to_string((s->*field).load(std::memory_order_relaxed)));
+    }
+}
+
+void Histogram(std::string& out, const Sessions& sessions, const char* name, const char* help,
+               MetricHistogram SessionMetrics::*field) {
+    Family(out, name, "histogram", help, true);
+    for (const SessionMetrics* s : sessions) {
+        const MetricHistogram& h = s->*field;
+        const std::string labels = Label(*s);
+
+        // Buckets are read one by one while the session may still be ticking;
+        // clamp so the exposition stays cumulative and count == +Inf bucket.
+        std::uint64_t cumulative = 0;
+        for (int b = 0; b < MetricHistogram::kBounds; ++b) {
+            cumulative += h.Bucket(b);
+            Sample(out, name, "_bucket",
+                labels + ",le=\"" + Seconds((double)MetricHistogram::kBoundsUs[(size_t)b]) + "\"",
+                std::to_string(cumulative));
+        }
+        cumulative += h.Bucket(MetricHistogram::kBounds);
+        Sample(out, name, "_bucket", labels + ",le=\"+Inf\"", std::to_string(cumulative));
+        Sample(out, name, "_count", labels, std::to_string(cumulative));
+        Sample(out, name, "_sum", labels, Seconds((double)h.SumUs()));
+    }
+}
+
+} // namespace
+
+void MetricsRegistry::Add(const SessionMetrics* session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_.push_back(session);
+}
+
+void MetricsRegistry::Remove(const SessionMetrics* session) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions_.erase(std::remove(sessions_.begin(), sessions_.end(), session), sessions_.end());
+}
+
+std::string MetricsRegistry::Render() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Sessions& s = sessions_;
+
+    std::string out;
+    out.reserve(2048 + s.size() * 2048);
+
+    Counter(out, s, "ticks", "Timer ticks processed.", &SessionMetrics::ticks);
+    Counter(out, s, "frames_written", "Frames handed to the display.", &SessionMetrics::framesWritten);
+    Counter(out, s, "frames_skipped", "Redundant frames not re-sent to the display.", &SessionMetrics::framesSkipped);
+    Counter(out, s, "frames_dropped", "Deadlines missed by a whole period (schedule resynced).", &SessionMetrics::framesDropped);
+    Counter(out, s, "late_ticks", "Ticks published after their deadline.", &SessionMetrics::lateTicks);
+    Counter(out, s, "passes", "Completed passes over all cells.", &SessionMetrics::passes);
+
+    Histogram(out, s, "tick_lateness_seconds", "Publish time minus tick deadline.", &SessionMetrics::tickLateness);
+    Histogram(out, s, "sink_latency_seconds", "Time spent handing a frame to the display.", &SessionMetrics::sinkLatency);
+
+    Gauge(out, s, "running", "1 while the session is running.", &SessionMetrics::running);
+    Gauge(out, s, "cells", "Cells in the calibrated line.", &SessionMetrics::cells);
+    Gauge(out, s, "progress_cells", "Position of the walk in the current pass.", &SessionMetrics::progressCells);
+
+    out += "# EOF\n";
+    return out;
+}
+
+MetricsFileExporter::MetricsFileExporter(const MetricsRegistry& registry, std::filesystem::path path,
+                                         std::int64_t periodMs)
+    : registry_(registry), path_(std::move(path)), periodMs_(std::max<std::int64_t>(periodMs, 100)),
+      thread_([this] { Run(); }) {}
+
+MetricsFileExporter::~MetricsFileExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void MetricsFileExporter::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        const bool quit = wake_.wait_for(lock, std::chrono::milliseconds(periodMs_), [this] { return quit_; });
+
+        lock.unlock();
+        WriteFileAtomic(path_, registry_.Render());
+        lock.lock();
+
+        if (quit) break;
+    }
+}
+
+} // namespace calibration
@@ -0,0 +1,114 @@
+#pragma once
+
+// Live counters per calibration session, exported as OpenMetrics text.
+//
+// Each engine owns (or is given) one SessionMetrics block and is its only
+// writer: the tick path does relaxed atomic increments and stores, nothing
+// else. An exporter thread reads the blocks of every registered session and
+// atomically replaces a text file a local scraper can pick up (for example
+// node_exporter's textfile collector).
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace calibration {
+
+// Fixed-bucket histogram; only the matching bucket, count and sum are bumped.
+// Bounds are in microseconds and exported in seconds.
+class MetricHistogram {
+public:
+    static constexpr int kBounds = 8;
+    static constexpr std::array<std::int64_t, kBounds> kBoundsUs = {
+        50, 100, 250, 500, 1000, 5000, 20000, 100000
+    };
+
+    void Observe(std::int64_t us) {
+        int b = 0;
+        while (b < kBounds && us > kBoundsUs[(size_t)b]) b++;
+        buckets_[(size_t)b].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sumUs_.fetch_add(us > 0 ? (std::uint64_t)us : 0, std::memory_order_relaxed);
+    }
+
+    std::uint64_t Bucket(int b) const { return buckets_[(size_t)b].load(std::memory_order_relaxed); }
+    std::uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+    std::uint64_t SumUs() const { return sumUs_.load(std::memory_order_relaxed); }
+
+private:
+    std::array<std::atomic<std::uint64_t>, kBounds + 1> buckets_{}; // last = +Inf
+    std::atomic<std::uint64_t> count_{ 0 };
+    std::atomic<std::uint64_t> sumUs_{ 0 };
+};
+
+struct SessionMetrics {
+    explicit SessionMetrics(std::string sessionName) : name(std::move(sessionName)) {}
+
+    void Add(std::atomic<std::uint64_t>& counter, std::uint64_t n = 1) {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    const std::string name;           // exported as the session label
+
+    std::atomic<std::uint64_t> ticks{ 0 };
+    std::atomic<std::uint64_t> framesWritten{ 0 };
+    std::atomic<std::uint64_t> framesSkipped{ 0 };  // redundant writes not sent
+    std::atomic<std::uint64_t> framesDropped{ 0 };  // deadline missed by a whole period (resync)
+    std::atomic<std::uint64_t> lateTicks{ 0 };
+    std::atomic<std::uint64_t> passes{ 0 };         // completed passes over all cells
+
+    MetricHistogram tickLateness;
+    MetricHistogram sinkLatency;
+
+    // Gauges
+    std::atomic<std::int64_t> running{ 0 };
+    std::atomic<std::int64_t> cells{ 0 };
+    std::atomic<std::int64_t> progressCells{ 0 };   // position in the current pass
+};
+
+class MetricsRegistry {
+public:
+    // Sessions must stay alive until removed.
+    void Add(const SessionMetrics* session);
+    void Remove(const SessionMetrics* session);
+
+    // OpenMetrics text exposition, terminated by "# EOF".
+    std::string Render() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<const SessionMetrics*> sessions_;
+};
+
+// Rewrites the metrics file every period on its own thread, and once more on
+// destruction so the final counts are kept.
+class MetricsFileExporter {
+public:
+    MetricsFileExporter(const MetricsRegistry& registry, std::filesystem::path path,
+                        std::int64_t periodMs);
+    ~MetricsFileExporter();
+
+    MetricsFileExporter(const MetricsFileExporter&) = delete;
+    MetricsFileExporter& operator=(const MetricsFileExporter&) = delete;
+
+private:
+    void Run();
+
+    const MetricsRegistry& registry_;
+    std::filesystem::path path_;
+    std::int64_t periodMs_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool quit_ = false;
+
+    std::thread thread_;
+};
+
+} // namespace calibration
@@ -9,6 +9,7 @@
 #define IDC_LOOP        1005
 
 #define IDC_WHOLELINE 1010
+#define IDC_OFFTIME     1011
 #define IDC_START       1006
 #define IDC_STOP        1007
 
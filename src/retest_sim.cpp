@@ -0,0 +1,198 @@
+#include "retest_sim.h"
+
+#include <algorithm>
+
+#include "work_stealing.h"
+
+namespace calibration {
+
+namespace {
+
+constexpr int kUnitsPerChunk = 64;
+
+// ON masks of a walking mode, [cell * subSteps + subStep]: the dash cycle
+// shows four patterns per cell, other modes one.
+struct WalkMasks {
+    int subSteps = 1;
+    std::vector<std::uint8_t> on;
+};
+
+WalkMasks BuildWalkMasks(const Settings& settings) {
+    // Row-major steps light cell == step; column-major lights the same mask.
+    Settings walk = settings;
+    if (walk.mode == Mode::AllDots_ColumnMajor) walk.mode = Mode::AllDots_RowMajor;
+
+    WalkMasks masks;
+    masks.subSteps = walk.mode == Mode::DashesCycle_14_25_36_78 ? 4 : 1;
+    const int cells = walk.TotalCells();
+    masks.on.resize((size_t)cells * masks.subSteps);
+    std::mt19937 unused;
+    std::wstring line;
+    for (int c = 0; c < cells; ++c) {
+        for (int sub = 0; sub < masks.subSteps; ++sub) {
+            BuildPatternLine(walk, true, c, sub, unused, line);
+            masks.on[(size_t)c * masks.subSteps + sub] = (std::uint8_t)(line[(size_t)c] - kBrailleBlank);
+        }
+    }
+    return masks;
+}
+
+// Shows single cells of a virtual display through its faulty pin and decides
+// whether the operator marks them. One per worker chunk.
+class CellShow {
+public:
+    CellShow(const Settings& settings, const WalkMasks& masks, const FaultConfig& faults, double falseMarkRate)
+        : cols_(settings.cols), subSteps_(masks.subSteps), onMask_(masks.on),
+          onUs_(1000LL * settings.intervalMs), offUs_(1000LL * settings.OffDurationMs()),
+          minVisibleUs_(1000LL * faults.minVisibleMs),
+          notice_(faults.noticeProbability), falseMark_(falseMarkRate) {
+        line_.assign((size_t)settings.TotalCells(), 0);
+    }
+
+    // Shows cell c at timeUs (advanced past it). True if the cell got marked.
+    bool Show(int c, FaultyPin* pin, std::int64_t& timeUs, std::mt19937& rng) {
+        const bool watched = pin && Near(pin->Cell(), c);
+        bool marked = false;
+        for (int sub = 0; sub < subSteps_; ++sub) {
+            line_[(size_t)c] = onMask_[(size_t)c * subSteps_ + sub];
+            marked |= Frame(pin, watched, onUs_, timeUs, rng);
+            line_[(size_t)c] = 0;
+            if (offUs_ > 0) marked |= Frame(pin, watched, offUs_, timeUs, rng);
+        }
+        if (!marked && falseMark_(rng)) marked = true;
+        return marked;
+    }
+
+private:
+    // The operator watches the lit cell and the cells touching it.
+    bool Near(int cell, int lit) const {
+        if (cell == lit || cell == lit - cols_ || cell == lit + cols_) return true;
+        return cell / cols_ == lit / cols_ && (cell == lit - 1 || cell == lit + 1);
+    }
+
+    bool Frame(FaultyPin* pin, bool watched, std::int64_t durUs, std::int64_t& timeUs, std::mt19937& rng) {
+        bool noticed = false;
+        if (pin) {
+            // Always fed, so the pin's state follows every frame.
+            const std::int64_t wrongUs = pin->WrongUs(line_.data(), timeUs, durUs, rng);
+            noticed = watched && wrongUs >= minVisibleUs_ && notice_(rng);
+        }
+        timeUs += durUs;
+        return noticed;
+    }
+
+    int cols_;
+    int subSteps_;
+    const std::vector<std::uint8_t>& onMask_;
+    std::int64_t onUs_;
+    std::int64_t offUs_;
+    std::int64_t minVisibleUs_;
+    std::bernoulli_distribution notice_;
+    std::bernoulli_distribution falseMark_;
+    std::vector<std::uint8_t> line_;
+};
+
+struct UnitResult {
+    bool adaptiveFailed = false;
+    bool adaptiveUndecided = false;
+    std::int64_t adaptiveUs = 0;
+    int adaptivePasses = 0;
+    std::uint64_t adaptiveShowings = 0;
+    bool blindFailed = false;
+};
+
+UnitResult RunUnit(const RetestSimConfig& config, CellShow& show, int model, std::mt19937& rng) {
+    const Settings& s = config.settings;
+    const int cells = s.TotalCells();
+    UnitResult r;
+
+    // model < 0: a good unit. Each strategy gets an identical copy of the pin.
+    FaultyPin pin;
+    if (model >= 0) pin = FaultyPin::Random((FaultModel)model, s.cols, cells, config.faults, rng);
+    FaultyPin* unitPin = model >= 0 ? &pin : nullptr;
+
+    {
+        FaultyPin copy = pin;
+        std::int64_t timeUs = 0;
+        for (int loop = 0; loop < config.blindLoops; ++loop) {
+            for (int c = 0; c < cells; ++c) {
+                if (show.Show(c, unitPin ? &copy : nullptr, timeUs, rng)) r.blindFailed = true;
+            }
+        }
+    }
+
+    AdaptiveRetest retest(s.cols, s.rows, config.retest);
+    std::int64_t timeUs = 0;
+    for (;;) {
+        const std::vector<int>& pass = retest.NextPass();
+        if (pass.empty()) break;
+        for (int c : pass) retest.Observe(c, show.Show(c, unitPin, timeUs, rng));
+        retest.FinishPass();
+    }
+    r.adaptiveFailed = retest.Verdict() == RetestVerdict::Fail;
+    r.adaptiveUndecided = retest.Verdict() == RetestVerdict::Undecided;
+    r.adaptiveUs = timeUs;
+    r.adaptivePasses = retest.Passes();
+    r.adaptiveShowings = retest.Showings();
+    return r;
+}
+
+} // namespace
+
+bool RetestModeSupported(const Settings& settings) {
+    return !settings.wholeLine && settings.mode != Mode::RandomGroupings;
+}
+
+RetestSimReport RunRetestComparison(const RetestSimConfig& config) {
+    RetestSimReport report;
+    const int units = std::max(config.faults.trials, 1);
+    const int rows = 1 + kFaultModelCount;   // good units, then each model
+    const int chunksPerRow = (units + kUnitsPerChunk - 1) / kUnitsPerChunk;
+    std::vector<UnitResult> results((size_t)rows * units);
+
+    const WalkMasks masks = BuildWalkMasks(config.settings);
+    const Settings& s = config.settings;
+    report.passUs = 1000LL * masks.subSteps * (s.intervalMs + s.OffDurationMs()) * s.TotalCells();
+
+    WorkStealingPool pool(config.faults.workers);
+    pool.Run(rows * chunksPerRow, [&](int chunk, int) {
+        const int row = chunk / chunksPerRow;
+        const int first = (chunk % chunksPerRow) * kUnitsPerChunk;
+        const int last = std::min(units, first + kUnitsPerChunk);
+
+        std::seed_seq seq{ config.faults.seed, (std::uint32_t)chunk };
+        std::mt19937 rng(seq);
+        CellShow show(config.settings, masks, config.faults, config.retest.falseMarkRate);
+        for (int u = first; u < last; ++u) {
+            results[(size_t)row * units + (size_t)u] = RunUnit(config, show, row - 1, rng);
+        }
+    });
+    report.workers = pool.Workers();
+
+    const std::int64_t blindUs = report.passUs * config.blindLoops;
+    for (int row = 0; row < rows; ++row) {
+        RetestCaseResult c;
+        c.name = row == 0 ? "no fault" : FaultModelName((FaultModel)(row - 1));
+        c.adaptive.units = c.blind.units = units;
+        double timeUs = 0.0, passes = 0.0, showings = 0.0;
+        for (int u = 0; u < units; ++u) {
+            const UnitResult& r = results[(size_t)row * units + (size_t)u];
+            c.adaptive.failed += r.adaptiveFailed ? 1 : 0;
+            c.adaptive.undecided += r.adaptiveUndecided ? 1 : 0;
+            c.blind.failed += r.blindFailed ? 1 : 0;
+            timeUs += (double)r.adaptiveUs;
+            passes += r.adaptivePasses;
+            showings += (double)r.adaptiveShowings;
+        }
+        c.adaptive.meanTimeUs = timeUs / units;
+        c.adaptive.meanPasses = passes / units;
+        c.adaptive.meanShowings = showings / units;
+        c.blind.meanTimeUs = (double)blindUs;
+        c.blind.meanPasses = config.blindLoops;
+        c.blind.meanShowings = (double)config.blindLoops * config.settings.TotalCells();
+        report.cases.push_back(c);
+    }
+    return report;
+}
+
+} // namespace calibration
@@ -0,0 +1,63 @@
+#pragma once
+
+// Adaptive retest (adaptive_retest.h) against N blind loops, on virtual
+// displays with the fault models of fault_sim.h.
+//
+// Each unit is a virtual display with one faulty pin (or none, for the good
+// units that make up most of production) shown cell by cell in a walking
+// mode. Showing a cell plays its ON and OFF frames (four of each for the dash
+// cycle) through the faulty pin. The operator watches the lit cell and the
+// cells around it, marks the lit cell when a wrong pin stays up long enough
+// to notice, and occasionally marks a good cell by mistake. A readback device
+// instead sees every wrong pin and rarely reports a false one.
+//
+// Blind testing shows the whole line N times and fails the unit on any mark.
+// Adaptive testing feeds the same kind of marks to AdaptiveRetest and runs the
+// passes it asks for. The comparison reports, per fault model and for good
+// units, how often each strategy fails the unit and the mean time it takes.
+
+#include <cstdint>
+#include <vector>
+
+#include "adaptive_retest.h"
+#include "calibration_engine.h"
+#include "fault_sim.h"
+
+namespace calibration {
+
+struct RetestSimConfig {
+    Settings settings;              // walking mode, geometry and timing
+    RetestConfig retest;
+    FaultConfig faults;             // fault parameters, operator, trials, workers, seed
+    int blindLoops = 3;
+};
+
+struct RetestStrategyResult {
+    int units = 0;
+    int failed = 0;                 // unit failed (for faulty units: fault found)
+    int undecided = 0;              // adaptive only: maxPasses reached
+    double meanTimeUs = 0.0;
+    double meanPasses = 0.0;
+    double meanShowings = 0.0;      // cells shown per unit
+
+    double FailRate() const { return units ? (double)failed / units : 0.0; }
+};
+
+struct RetestCaseResult {
+    const char* name = "";          // "no fault" or a fault model
+    RetestStrategyResult adaptive;
+    RetestStrategyResult blind;
+};
+
+struct RetestSimReport {
+    std::int64_t passUs = 0;        // one full pass over the line
+    int workers = 1;
+    std::vector<RetestCaseResult> cases;  // good units first, then each fault model
+};
+
+// Walking modes only: the operator cannot judge random groupings.
+bool RetestModeSupported(const Settings& settings);
+
+RetestSimReport RunRetestComparison(const RetestSimConfig& config);
+
+} // namespace calibration
@@ -0,0 +1,160 @@
+#include "rt_thread.h"
+
+#include <cstring>
+#include <thread>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace calibration {
+
+namespace {
+
+void AddNote(std::string& notes, const std::string& note) {
+    if (!notes.empty()) notes += "; ";
+    notes += note;
+}
+
+int PickCpu(int requested) {
+    const unsigned hw = std::thread::hardware_concurrency();
+    const int cpus = hw ? (int)hw : 1;
+    if (requested >= 0 && requested < cpus) return requested;
+    return cpus - 1;
+}
+
+#if defined(__linux__)
+
+// Touches the stack below this frame so the tick path does not fault it in.
+// noinline: the array has to live in its own, deeper frame.
+__attribute__((noinline)) void PrefaultStack(int kb) {
+    if (kb <= 0) return;
+    volatile char* page = static_cast<volatile char*>(__builtin_alloca((size_t)kb * 1024));
+    for (int i = 0; i < kb * 1024; i += 4096) page[i] = 0;
+}
+
+#endif
+
+} // namespace
+
+RealTimeStatus EnterRealTime(const RealTimeConfig& config) {
+    RealTimeStatus status;
+    int cpu = PickCpu(config.cpu);
+    if (config.cpu >= 0 && cpu != config.cpu) {
+        AddNote(status.notes, "cpu " + std::to_string(config.cpu) + " does not exist, using " + std::to_string(cpu));
+    }
+
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &set)) status.previousCpus.push_back(c);
+        }
+    }
+    // Default: the last CPU this thread may use (often the least busy one).
+    if (config.cpu < 0 && !status.previousCpus.empty()) cpu = status.previousCpus.back();
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err == 0) {
+        status.cpu = cpu;
+    } else {
+        AddNote(status.notes, std::string("not pinned: ") + std::strerror(err));
+    }
+
+    // The runner spins through the last stretch before a deadline; under
+    // SCHED_FIFO that would starve every other thread if it had no CPU of its own.
+    if (status.previousCpus.size() == 1) {
+        AddNote(status.notes, "SCHED_FIFO skipped: only one CPU available");
+    } else {
+        sched_param param{};
+        param.sched_priority = config.priority;
+        err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err == 0) {
+            status.priority = config.priority;
+        } else {
+            AddNote(status.notes, std::string("SCHED_FIFO refused (") + std::strerror(err) +
+                "), normal priority");
+        }
+    }
+
+    if (config.lockMemory) {
+        if (mlockall(MCL_CURRENT) == 0) {
+            status.memoryLocked = true;
+        } else {
+            AddNote(status.notes, std::string("memory not locked: ") + std::strerror(errno));
+        }
+    }
+    PrefaultStack(config.prefaultStackKb);
+#elif defined(_WIN32)
+    if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0) {
+        status.cpu = cpu;
+    } else {
+        AddNote(status.notes, "not pinned: error " + std::to_string(GetLastError()));
+    }
+    if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        status.priority = config.priority;
+    } else {
+        AddNote(status.notes, "priority not raised: error " + std::to_string(GetLastError()));
+    }
+    if (config.lockMemory) AddNote(status.notes, "memory locking not supported");
+#else
+    (void)cpu;
+    AddNote(status.notes, "real-time scheduling not supported on this platform");
+#endif
+    return status;
+}
+
+void LeaveRealTime(const RealTimeStatus& status) {
+#if defined(__linux__)
+    if (status.memoryLocked) munlockall();
+    if (status.priority > 0) {
+        sched_param param{};
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    }
+    if (status.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int c : status.previousCpus) CPU_SET(c, &set);
+        if (status.previousCpus.empty()) {
+            const unsigned hw = std::thread::hardware_concurrency();
+            for (unsigned c = 0; c < (hw ? hw : 1) && c < CPU_SETSIZE; ++c) CPU_SET(c, &set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#elif defined(_WIN32)
+    if (status.priority > 0) SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+    if (status.cpu >= 0) {
+        DWORD_PTR process = 0, system = 0;
+        if (GetProcessAffinityMask(GetCurrentProcess(), &process, &system)) {
+            SetThreadAffinityMask(GetCurrentThread(), process);
+        }
+    }
+#else
+    (void)status;
+#endif
+}
+
+std::string DescribeRealTime(const RealTimeStatus& status) {
+    std::string text = status.cpu >= 0 ? "cpu " + std::to_string(status.cpu) : std::string("not pinned");
+    if (status.priority > 0) {
+#ifdef _WIN32
+        text += ", time-critical priority";
+#else
+        text += ", SCHED_FIFO " + std::to_string(status.priority);
+#endif
+    } else {
+        text += ", normal priority";
+    }
+    text += status.memoryLocked ? ", memory locked" : ", memory not locked";
+    if (!status.notes.empty()) text += " (" + status.notes + ")";
+    return text;
+}
+
+} // namespace calibration
@@ -0,0 +1,54 @@
+#pragma once
+
+// Opt-in real-time setup for the thread that runs the timer path.
+//
+// A precise sleep does not help when the tick thread is preempted by other
+// load or takes a page fault in the middle of a frame. EnterRealTime puts the
+// calling thread on one CPU, raises it to SCHED_FIFO, locks the memory the
+// process has mapped and touches a stretch of stack, so the tick path neither
+// migrates nor faults. Call it after the engine has started: by then both
+// frame buffers have been written once, and locking keeps them resident.
+// Later mappings are not locked, so threads started afterwards (each with its
+// own stack) do not run into the lock limit.
+//
+// Every step is optional and may be refused (SCHED_FIFO and mlockall need
+// CAP_SYS_NICE / CAP_IPC_LOCK or matching rlimits). A refused step is noted
+// and skipped; the run continues with whatever was granted. SCHED_FIFO is not
+// requested when the thread may only use one CPU: the runner's spin before
+// each deadline would then starve the rest of the process. On Windows the
+// thread is pinned and raised to time-critical priority; memory is not locked.
+// Other platforms report that nothing was applied.
+
+#include <string>
+#include <vector>
+
+namespace calibration {
+
+struct RealTimeConfig {
+    int cpu = -1;           // CPU to pin to, -1: the last one
+    int priority = 50;      // SCHED_FIFO priority (1..99)
+    bool lockMemory = true;
+    int prefaultStackKb = 256;
+};
+
+struct RealTimeStatus {
+    int cpu = -1;               // pinned CPU, -1 if not pinned
+    int priority = 0;           // SCHED_FIFO priority, 0 if not raised
+    bool memoryLocked = false;
+    std::string notes;          // what was refused, and why
+    std::vector<int> previousCpus;  // affinity before pinning, restored on leaving
+
+    bool Full() const { return cpu >= 0 && priority > 0 && memoryLocked; }
+};
+
+// Applies config to the calling thread (memory locking is process-wide).
+RealTimeStatus EnterRealTime(const RealTimeConfig& config);
+
+// Back to normal scheduling on the CPUs it had before, memory unlocked.
+// Calling thread only.
+void LeaveRealTime(const RealTimeStatus& status);
+
+// "cpu 3, SCHED_FIFO 50, memory locked" plus any notes.
+std::string DescribeRealTime(const RealTimeStatus& status);
+
+} // namespace calibration
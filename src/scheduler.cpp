@@ -0,0 +1,103 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "trace.h"
+
+namespace calibration {
+
+namespace {
+
+// OS sleeps overshoot by up to a scheduler quantum; spin for the remainder.
+constexpr std::int64_t kSpinWindowUs = 1000;
+
+void ApplyReconfigure(Engine& engine, RunnerCommands& commands) {
+    Settings settings;
+    if (commands.TakeReconfigure(settings)) {
+        engine.Reconfigure(settings);
+    }
+}
+
+bool CommandPending(const RunnerCommands* commands, bool paused) {
+    if (!commands) return false;
+    return commands->stop.load(std::memory_order_acquire) ||
+           commands->pause.load(std::memory_order_relaxed) != paused ||
+           commands->seekBy.load(std::memory_order_relaxed) != 0 ||
+           commands->seekRowsBy.load(std::memory_order_relaxed) != 0;
+}
+
+} // namespace
+
+bool SleepUntilUs(const SteadyClock& clock, std::int64_t targetUs,
+                  const RunnerCommands* commands, bool paused) {
+    for (;;) {
+        if (CommandPending(commands, paused)) return false;
+
+        const std::int64_t remaining = targetUs - clock.NowUs();
+        if (remaining <= kSpinWindowUs) break;
+
+        // Sleep in slices so commands are seen within kCommandPollUs.
+        const std::int64_t slice = commands
+            ? std::min(remaining - kSpinWindowUs, kCommandPollUs)
+            : remaining - kSpinWindowUs;
+        std::this_thread::sleep_for(std::chrono::microseconds(slice));
+    }
+
+    while (clock.NowUs() < targetUs) {
+        if (CommandPending(commands, paused)) return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+void RunRealTime(Engine& engine, const SteadyClock& clock,
+                 RunnerCommands& commands, std::int64_t endUs,
+                 std::uint64_t maxTicks, RunnerHook* hook) {
+    while (engine.Running()) {
+        if (commands.stop.load(std::memory_order_acquire)) {
+            engine.Stop(commands.stopRequestedUs.load(std::memory_order_relaxed));
+            break;
+        }
+
+        const bool pause = commands.pause.load(std::memory_order_relaxed);
+        if (pause != engine.Paused()) engine.SetPaused(pause);
+
+        const int seek = commands.seekBy.exchange(0, std::memory_order_acquire);
+        if (seek != 0) engine.Seek(engine.StepIndex() + seek);
+
+        const int seekRows = commands.seekRowsBy.exchange(0, std::memory_order_acquire);
+        if (seekRows != 0) {
+            const Settings& s = engine.GetSettings();
+            const int cell = StepToCellIndex(s, engine.StepIndex());
+            const int row = std::max(0, std::min(cell / s.cols + seekRows, s.rows - 1));
+            engine.Seek(CellToStepIndex(s, row * s.cols + cell % s.cols));
+        }
+
+        if (engine.Paused()) {
+            SleepUntilUs(clock, clock.NowUs() + kCommandPollUs, &commands, true);
+            continue;
+        }
+        if (engine.NextTickUs() > endUs) break;
+        if (maxTicks && engine.GetStats().ticks >= maxTicks) break;
+
+        {
+            TraceSpan span("wait for wake");
+            if (!SleepUntilUs(clock, engine.NextWakeUs(), &commands, false)) continue;
+        }
+        TraceInstant("wake");
+        ApplyReconfigure(engine, commands);
+        engine.PrepareTick();
+
+        {
+            TraceSpan span("wait for deadline");
+            if (!SleepUntilUs(clock, engine.NextTickUs(), &commands, false)) continue;
+        }
+        ApplyReconfigure(engine, commands);
+        engine.Tick();
+        if (hook) hook->AfterTick(engine);
+    }
+}
+
+} // namespace calibration
@@ -0,0 +1,84 @@
+#pragma once
+
+// Real-time driver for the engine, for runners without a window message loop
+// (the simulator's --realtime mode). The dialog uses WM_TIMER instead.
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+// Priority commands for a runner thread, settable from any thread. The runner
+// polls them at least every kCommandPollUs, including while it waits for a
+// deadline, so stop and pause never wait for the rest of an interval.
+struct RunnerCommands {
+    std::atomic<bool> stop{ false };
+    std::atomic<bool> pause{ false };
+    std::atomic<std::int64_t> stopRequestedUs{ -1 };
+    std::atomic<int> seekBy{ 0 };   // steps to move the walk, summed until taken
+    std::atomic<int> seekRowsBy{ 0 };  // display rows to move the lit cell, summed until taken
+
+    void RequestStop(const Clock& clock) {
+        stopRequestedUs.store(clock.NowUs(), std::memory_order_relaxed);
+        stop.store(true, std::memory_order_release);
+    }
+
+    void RequestSeek(int steps) { seekBy.fetch_add(steps, std::memory_order_release); }
+
+    // Up/down on the display grid; the runner maps it to a step in the current
+    // walk order (one row is `cols` steps row-major, one step column-major).
+    void RequestSeekRows(int rows) { seekRowsBy.fetch_add(rows, std::memory_order_release); }
+
+    // Live reconfiguration; the runner hands it to Engine::Reconfigure before
+    // the next frame is built or published.
+    void RequestReconfigure(const Settings& settings) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        settings_ = settings;
+        reconfigure_.store(true, std::memory_order_release);
+    }
+
+    bool TakeReconfigure(Settings& out) {
+        if (!reconfigure_.load(std::memory_order_acquire)) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        out = settings_;
+        reconfigure_.store(false, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    Settings settings_;
+    std::atomic<bool> reconfigure_{ false };
+};
+
+constexpr std::int64_t kCommandPollUs = 500;
+
+// Runs on the runner thread right after each tick, while the next deadline is
+// still an interval away (e.g. periodic checkpoints). Keep it short: copy what
+// is needed and hand any I/O to another thread.
+class RunnerHook {
+public:
+    virtual ~RunnerHook() = default;
+    virtual void AfterTick(Engine& engine) = 0;
+};
+
+// Sleeps until targetUs on the steady clock: a coarse sleep, then a short spin
+// for the last stretch so wake-up error stays in the microsecond range.
+// Returns false early if a stop or pause change is pending in commands.
+bool SleepUntilUs(const SteadyClock& clock, std::int64_t targetUs,
+                  const RunnerCommands* commands = nullptr, bool paused = false);
+
+// Runs the engine on the calling thread until it stops, a stop is requested,
+// the next deadline is past endUs, or the engine has ticked maxTicks times
+// (0 = no limit). Each frame is built at NextWakeUs() (just
+// early enough for the estimated build + sink cost) and published at its
+// deadline. A stop request preempts any wait or prepared frame and publishes
+// the blank line at once. hook (optional) runs after every tick.
+void RunRealTime(Engine& engine, const SteadyClock& clock,
+                 RunnerCommands& commands, std::int64_t endUs,
+                 std::uint64_t maxTicks = 0, RunnerHook* hook = nullptr);
+
+} // namespace calibration
@@ -0,0 +1,184 @@
+#include "session_batch.h"
+
+#include <algorithm>
+
+namespace calibration {
+
+void SessionBatch::Reserve(int sessions) {
+    const size_t n = (size_t)sessions;
+    phaseOn_.reserve(n);
+    step_.reserve(n);
+    dash_.reserve(n);
+    total_.reserve(n);
+    running_.reserve(n);
+    finishPending_.reserve(n);
+    flags_.reserve(n);
+    stopMask_.reserve(n);
+    settings_.reserve(n);
+    rng_.reserve(n);
+}
+
+int SessionBatch::Add(const Settings& settings, std::uint32_t seed) {
+    std::int32_t flags = 0;
+    if (settings.mode == Mode::RandomGroupings && !settings.wholeLine) flags |= kFrozen;
+    if (settings.OffDurationMs() > 0) flags |= kHasOff;
+    if (settings.wholeLine) flags |= kWholeLine;
+    if (settings.mode == Mode::DashesCycle_14_25_36_78) flags |= kDashCycle;
+    if (settings.loop) flags |= kLoop;
+
+    phaseOn_.push_back(1);
+    step_.push_back(0);
+    dash_.push_back(0);
+    total_.push_back(settings.TotalCells());
+    running_.push_back(1);
+    finishPending_.push_back(0);
+    flags_.push_back(flags);
+    stopMask_.push_back(0);
+
+    settings_.push_back(settings);
+    rng_.emplace_back(seed);
+    return Size() - 1;
+}
+
+namespace {
+
+// a where m is 1, b where m is 0.
+inline std::int32_t Select(std::int32_t m, std::int32_t a, std::int32_t b) {
+    return b ^ ((a ^ b) & -m);
+}
+
+// The lanes are separate arrays; __restrict lets the compiler vectorize
+// without run-time overlap checks for all eight of them.
+int AdvanceLanes(int n, std::int32_t* __restrict phaseOn, std::int32_t* __restrict step,
+                 std::int32_t* __restrict dash, std::int32_t* __restrict running,
+                 std::int32_t* __restrict finishPending, std::int32_t* __restrict stopMask,
+                 const std::int32_t* __restrict total, const std::int32_t* __restrict flags) {
+    int stillRunning = 0;
+
+    for (int i = 0; i < n; ++i) {
+        const std::int32_t f = flags[i];
+        const std::int32_t frozen = f & 1;            // bit order of Flags
+        const std::int32_t hasOff = (f >> 1) & 1;
+        const std::int32_t wholeLine = (f >> 2) & 1;
+        const std::int32_t dashCycle = (f >> 3) & 1;
+        const std::int32_t loop = (f >> 4) & 1;
+
+        const std::int32_t run = running[i];
+        const std::int32_t pending = finishPending[i];
+        const std::int32_t on = phaseOn[i];
+
+        // Lanes that step this tick: running, no stop pending, not free-running.
+        const std::int32_t moves = run & (pending ^ 1) & (frozen ^ 1);
+        const std::int32_t goesOff = moves & on & hasOff;
+        const std::int32_t advances = moves & (goesOff ^ 1);   // OFF -> ON, or ON -> ON
+
+        const std::int32_t d = dash[i] + (advances & dashCycle);
+        const std::int32_t dashWrap = (std::int32_t)(d >= 4);
+        const std::int32_t cycleDone = Select(dashCycle, dashWrap, 1);
+
+        const std::int32_t walks = advances & (wholeLine ^ 1);
+        const std::int32_t s = step[i] + (walks & cycleDone);
+        const std::int32_t walkEnd = walks & (std::int32_t)(s >= total[i]);
+        const std::int32_t wholeEnd = advances & wholeLine & cycleDone;
+        const std::int32_t passDone = (walkEnd | wholeEnd) & (loop ^ 1);
+
+        // Engine::FinishPass: with an OFF phase the pass ends on an (already
+        // blank) OFF tick; without one the last ON frame keeps its full duration.
+        const std::int32_t stops = (run & pending) | (passDone & hasOff);
+
+        phaseOn[i] = (on & (goesOff ^ 1)) | advances;
+        dash[i] = Select(dashWrap, 0, d);
+        step[i] = Select(walkEnd & loop, 0, s);
+        finishPending[i] = passDone & (hasOff ^ 1);
+        running[i] = run & (stops ^ 1);
+        stopMask[i] = stops;
+        stillRunning += run & (stops ^ 1);
+    }
+    return stillRunning;
+}
+
+} // namespace
+
+int SessionBatch::AdvanceAll() {
+    return AdvanceLanes(Size(), phaseOn_.data(), step_.data(), dash_.data(), running_.data(),
+        finishPending_.data(), stopMask_.data(), total_.data(), flags_.data());
+}
+
+int SessionBatch::AdvanceAllScalar() {
+    const int n = Size();
+    int running = 0;
+
+    for (int i = 0; i < n; ++i) {
+        stopMask_[(size_t)i] = 0;
+        if (!running_[(size_t)i]) continue;
+
+        // A pass that ended without an OFF phase stops on the following tick.
+        if (finishPending_[(size_t)i]) {
+            finishPending_[(size_t)i] = 0;
+            running_[(size_t)i] = 0;
+            stopMask_[(size_t)i] = 1;
+            continue;
+        }
+        running++;
+
+        // Same transitions as Engine::AdvanceState.
+        const std::int32_t f = flags_[(size_t)i];
+        if (f & kFrozen) continue;
+
+        if (phaseOn_[(size_t)i] && (f & kHasOff)) {
+            phaseOn_[(size_t)i] = 0;
+            continue;
+        }
+        phaseOn_[(size_t)i] = 1;
+
+        bool passDone = false;
+        if (f & kWholeLine) {
+            if (f & kDashCycle) {
+                if (++dash_[(size_t)i] >= 4) {
+                    dash_[(size_t)i] = 0;
+                    passDone = !(f & kLoop);
+                }
+            } else {
+                passDone = !(f & kLoop);
+            }
+        } else {
+            if (f & kDashCycle) {
+                if (++dash_[(size_t)i] >= 4) {
+                    dash_[(size_t)i] = 0;
+                    step_[(size_t)i]++;
+                }
+            } else {
+                step_[(size_t)i]++;
+            }
+
+            if (step_[(size_t)i] >= total_[(size_t)i]) {
+                if (f & kLoop) step_[(size_t)i] = 0;
+                else passDone = true;
+            }
+        }
+
+        // Engine::FinishPass: with an OFF phase the pass ends on an (already
+        // blank) OFF tick; without one the last ON frame keeps its full duration.
+        if (passDone) {
+            if (f & kHasOff) {
+                running_[(size_t)i] = 0;
+                stopMask_[(size_t)i] = 1;
+                running--;
+            } else {
+                finishPending_[(size_t)i] = 1;
+            }
+        }
+    }
+    return running;
+}
+
+void SessionBatch::BuildLine(int i, std::wstring& out) {
+    const size_t s = (size_t)i;
+    if (!running_[s] || finishPending_[s]) {
+        out.assign((size_t)std::max(total_[s], 0), kBrailleBlank);
+        return;
+    }
+    BuildPatternLine(settings_[s], phaseOn_[s] != 0, step_[s], dash_[s], rng_[s], out);
+}
+
+} // namespace calibration
@@ -0,0 +1,92 @@
+#pragma once
+
+// Many calibration sessions stepped together (fleet simulations, test plans on
+// one core).
+//
+// An Engine keeps everything about a session in one object: settings, the
+// 5 KB random generator, frame buffers, statistics. Advancing thousands of them
+// drags all of that through the cache for the few fields a tick changes. The
+// batch splits the state instead: the per-tick fields (phase, step, dash
+// sub-step, pass length, run flags) are structure-of-arrays, one dense int32
+// array per field, so advancing every session streams ~28 bytes each. Settings
+// and generators are cold and only touched when a frame is built.
+//
+// AdvanceAll() makes the same state transition as Engine::Tick() for each
+// running session (the frame for the current state is built beforehand with
+// BuildLine()). There is no clock: every call is one tick of every session.
+// Live reconfiguration and pausing are not supported.
+//
+// The advance has no data-dependent branches: every condition is a 0/1 lane
+// value and every update a select, so the loop vectorizes and a mix of modes
+// costs the same as a uniform batch. AdvanceAllScalar() is the same transition
+// written like Engine::AdvanceState; the explorer checks the two agree.
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+class SessionBatch {
+public:
+    // Per-session configuration bits, precomputed from the settings.
+    enum Flags : std::int32_t {
+        kFrozen = 1,      // random groupings without whole-line: state never advances
+        kHasOff = 2,      // OFF phase kept
+        kWholeLine = 4,
+        kDashCycle = 8,
+        kLoop = 16,
+    };
+
+    void Reserve(int sessions);
+
+    // Starts a session like Engine::Start and returns its index. Start also
+    // publishes the first frame; build it with BuildLine() to keep random modes
+    // on the same sequence as an engine.
+    int Add(const Settings& settings, std::uint32_t seed);
+
+    int Size() const { return (int)flags_.size(); }
+
+    // One tick for every running session; returns how many are still running.
+    // Sessions that stopped on this tick are flagged in StopMask().
+    int AdvanceAll();
+    int AdvanceAllScalar();
+
+    // Frame the session's next tick publishes: blank once it has stopped or is
+    // about to stop.
+    void BuildLine(int i, std::wstring& out);
+
+    bool Running(int i) const { return running_[(size_t)i] != 0; }
+    bool Finishing(int i) const { return finishPending_[(size_t)i] != 0; }
+    bool PhaseOn(int i) const { return phaseOn_[(size_t)i] != 0; }
+    int StepIndex(int i) const { return step_[(size_t)i]; }
+    int DashSubStep(int i) const { return dash_[(size_t)i]; }
+    const Settings& GetSettings(int i) const { return settings_[(size_t)i]; }
+
+    // 1 for sessions the last advance stopped, else 0.
+    const std::vector<std::int32_t>& StopMask() const { return stopMask_; }
+
+    // Bytes a tick reads and writes per session.
+    static constexpr std::size_t kHotBytesPerSession = 7 * sizeof(std::int32_t);
+
+private:
+    // Hot: one entry per session in each array.
+    std::vector<std::int32_t> phaseOn_;
+    std::vector<std::int32_t> step_;
+    std::vector<std::int32_t> dash_;
+    std::vector<std::int32_t> total_;
+    std::vector<std::int32_t> running_;
+    std::vector<std::int32_t> finishPending_;
+    std::vector<std::int32_t> flags_;
+    std::vector<std::int32_t> stopMask_;
+
+    // Cold: only for building frames.
+    std::vector<Settings> settings_;
+    std::vector<std::mt19937> rng_;
+};
+
+} // namespace calibration
@@ -0,0 +1,236 @@
+#include "session_bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <string>
+
+#include "calibration_engine.h"
+#include "session_batch.h"
+
+namespace calibration {
+
+namespace {
+
+constexpr int kCheckSessions = 4096;
+constexpr int kCheckTicks = 300;
+constexpr int kMaxReportedMismatches = 20;
+
+// Deterministic mix of modes, traversals and geometries; one session in eight
+// has loop off so the stop path is part of the workload.
+Settings MixedSettings(int i) {
+    static const int kCols[] = { 20, 32, 40, 80 };
+    Settings s;
+    s.cols = kCols[i % 4];
+    s.rows = 1 + (i / 4) % 4;
+    s.mode = (Mode)((i / 16) % kModeCount);
+    s.wholeLine = (i / 240) % 4 == 0;
+    s.offMs = (i / 960) % 3 == 0 ? 0 : -1;
+    s.loop = i % 8 != 5;
+    return s;
+}
+
+class DiscardSink : public FrameSink {
+public:
+    void WriteFrame(const std::wstring&, std::int64_t) override {}
+};
+
+// Keeps the first frame since the last Clear(): the one a tick publishes
+// before a stop that ends the pass publishes the blank line.
+class FirstFrameSink : public FrameSink {
+public:
+    void WriteFrame(const std::wstring& line, std::int64_t) override {
+        if (!haveFrame) frame = line;
+        haveFrame = true;
+    }
+    void Clear() { haveFrame = false; }
+
+    std::wstring frame;
+    bool haveFrame = false;
+};
+
+// The layout the dialog started from: settings, stepping state and generator
+// side by side in one struct per session.
+struct StructSession {
+    Settings settings;
+    bool running = true;
+    bool finishPending = false;
+    bool phaseOn = true;
+    int stepIndex = 0;
+    int dashSubStep = 0;
+    std::mt19937 rng;
+
+    // Engine::Tick without the frame: stop if pending, else AdvanceState.
+    void Advance() {
+        if (!running) return;
+        if (finishPending) {
+            running = false;
+            finishPending = false;
+            return;
+        }
+        if (settings.mode == Mode::RandomGroupings && !settings.wholeLine) return;
+        if (phaseOn && settings.OffDurationMs() > 0) {
+            phaseOn = false;
+            return;
+        }
+        phaseOn = true;
+
+        const bool dash = settings.mode == Mode::DashesCycle_14_25_36_78;
+        bool passDone = false;
+        if (settings.wholeLine) {
+            if (!dash || ++dashSubStep >= 4) {
+                if (dash) dashSubStep = 0;
+                passDone = !settings.loop;
+            }
+        } else {
+            if (!dash || ++dashSubStep >= 4) {
+                if (dash) dashSubStep = 0;
+                stepIndex++;
+            }
+            if (stepIndex >= settings.TotalCells()) {
+                if (settings.loop) stepIndex = 0;
+                else passDone = true;
+            }
+        }
+        if (passDone) {
+            if (settings.OffDurationMs() > 0) running = false;
+            else finishPending = true;
+        }
+    }
+};
+
+// Engines and the batch step the same sessions; state and frames must agree
+// after every tick.
+int CheckBatchAgainstEngines(int sessions, std::FILE* out) {
+    const int n = std::min(sessions, kCheckSessions);
+    VirtualClock clock;
+    FirstFrameSink sink;
+    std::deque<Engine> engines;
+    SessionBatch batch;
+    batch.Reserve(n);
+    for (int i = 0; i < n; ++i) {
+        engines.emplace_back();
+        Engine& e = engines.back();
+        e.SetClock(&clock);
+        e.SetSink(&sink);
+        e.SetSuppressRedundantFrames(false);
+        e.Start(MixedSettings(i), (std::uint32_t)i + 1);
+        batch.Add(MixedSettings(i), (std::uint32_t)i + 1);
+    }
+
+    int mismatches = 0;
+    std::wstring line;
+    for (int i = 0; i < n; ++i) batch.BuildLine(i, line); // Start's first frame
+
+    for (int t = 0; t < kCheckTicks; ++t) {
+        for (int i = 0; i < n; ++i) {
+            Engine& e = engines[(size_t)i];
+            const bool wasRunning = e.Running();
+            batch.BuildLine(i, line);
+            sink.Clear();
+            e.Tick();
+
+            if (wasRunning && sink.frame != line && mismatches++ < kMaxReportedMismatches && out) {
+                std::fprintf(out, "session %d tick %d: batch frame differs from engine\n", i, t);
+            }
+        }
+        batch.AdvanceAll();
+
+        for (int i = 0; i < n; ++i) {
+            const Engine& e = engines[(size_t)i];
+            if (e.Running() != batch.Running(i) || (e.Running() &&
+                (e.PhaseOn() != batch.PhaseOn(i) || e.StepIndex() != batch.StepIndex(i) ||
+                e.DashSubStep() != batch.DashSubStep(i) || e.Finishing() != batch.Finishing(i)))) {
+                if (mismatches++ < kMaxReportedMismatches && out) {
+                    std::fprintf(out, "session %d tick %d: batch state differs from engine\n", i, t);
+                }
+            }
+        }
+    }
+    return mismatches;
+}
+
+template <typename Round>
+SessionBenchResult Measure(const char* name, int sessions, double minSeconds, Round round) {
+    using Clock = std::chrono::steady_clock;
+    SessionBenchResult r;
+    r.name = name;
+
+    const Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    do {
+        round();
+        r.sessionTicks += (std::uint64_t)sessions;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    r.seconds = elapsed;
+    return r;
+}
+
+} // namespace
+
+SessionBenchReport RunSessionBenchmark(int sessions, double secondsPerVariant, std::FILE* out) {
+    SessionBenchReport report;
+    report.sessions = sessions;
+    report.engineBytes = sizeof(Engine);
+    report.structBytes = sizeof(StructSession);
+    report.hotBytes = SessionBatch::kHotBytesPerSession;
+    report.mismatches = CheckBatchAgainstEngines(sessions, out);
+
+    // Engines: build, publish and advance, one object per session.
+    {
+        VirtualClock clock;
+        DiscardSink sink;
+        std::deque<Engine> engines;
+        for (int i = 0; i < sessions; ++i) {
+            engines.emplace_back();
+            engines.back().SetClock(&clock);
+            engines.back().SetSink(&sink);
+            engines.back().Start(MixedSettings(i), (std::uint32_t)i + 1);
+        }
+        report.results.push_back(Measure("engine tick (build + write + advance)", sessions, secondsPerVariant,
+            [&] { for (Engine& e : engines) e.Tick(); }));
+    }
+
+    // Struct per session: advance only.
+    {
+        std::vector<StructSession> structs((size_t)sessions);
+        for (int i = 0; i < sessions; ++i) {
+            structs[(size_t)i].settings = MixedSettings(i);
+            structs[(size_t)i].rng.seed((std::uint32_t)i + 1);
+        }
+        report.results.push_back(Measure("struct per session, advance", sessions, secondsPerVariant,
+            [&] { for (StructSession& s : structs) s.Advance(); }));
+    }
+
+    // Structure of arrays: scalar and branch-free advance, then build + advance.
+    {
+        SessionBatch batch;
+        batch.Reserve(sessions);
+        for (int i = 0; i < sessions; ++i) batch.Add(MixedSettings(i), (std::uint32_t)i + 1);
+        report.results.push_back(Measure("session batch, scalar advance", sessions, secondsPerVariant,
+            [&] { batch.AdvanceAllScalar(); }));
+    }
+    {
+        SessionBatch batch;
+        batch.Reserve(sessions);
+        for (int i = 0; i < sessions; ++i) batch.Add(MixedSettings(i), (std::uint32_t)i + 1);
+        report.results.push_back(Measure("session batch, branch-free advance", sessions, secondsPerVariant,
+            [&] { batch.AdvanceAll(); }));
+    }
+    {
+        SessionBatch batch;
+        batch.Reserve(sessions);
+        for (int i = 0; i < sessions; ++i) batch.Add(MixedSettings(i), (std::uint32_t)i + 1);
+        std::wstring line;
+        report.results.push_back(Measure("session batch, build + advance", sessions, secondsPerVariant,
+            [&] {
+                for (int i = 0; i < sessions; ++i) batch.BuildLine(i, line);
+                batch.AdvanceAll();
+            }));
+    }
+    return report;
+}
+
+} // namespace calibration
@@ -0,0 +1,35 @@
+#pragma once
+
+// Throughput of stepping many sessions on one core: session ticks per second
+// for engines (one object per session), for a struct-per-session layout of the
+// stepping state, and for the structure-of-arrays SessionBatch. Before timing,
+// the batch is checked tick by tick against engines running the same sessions.
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace calibration {
+
+struct SessionBenchResult {
+    const char* name = "";
+    std::uint64_t sessionTicks = 0;
+    double seconds = 0.0;
+
+    double PerSecond() const { return seconds > 0 ? sessionTicks / seconds : 0.0; }
+};
+
+struct SessionBenchReport {
+    int sessions = 0;
+    int mismatches = 0;         // batch vs engine disagreements in the check
+    std::size_t engineBytes = 0;     // sizeof(Engine)
+    std::size_t structBytes = 0;     // stride of the struct-per-session layout
+    std::size_t hotBytes = 0;        // SoA bytes a tick touches per session
+    std::vector<SessionBenchResult> results;
+};
+
+// Each variant runs whole rounds (one tick of every session) for at least
+// secondsPerVariant of wall time.
+SessionBenchReport RunSessionBenchmark(int sessions, double secondsPerVariant, std::FILE* out);
+
+} // namespace calibration
@@ -0,0 +1,42 @@
+#include "session_pool.h"
+
+namespace calibration {
+
+Engine* SessionPool::Acquire(int cells) {
+    stats_.live++;
+
+    std::vector<Engine*>& idle = idle_[cells];
+    if (!idle.empty()) {
+        Engine* engine = idle.back();
+        idle.pop_back();
+        stats_.reused++;
+        return engine;
+    }
+
+    storage_.emplace_back();
+    Engine* engine = &storage_.back();
+    engine->ReserveFrames(cells);
+    cellsOf_[engine] = cells;
+    stats_.created++;
+    return engine;
+}
+
+void SessionPool::Release(Engine* engine) {
+    if (!engine) return;
+
+    // Stop while the caller's sink and clock are still attached, so the blank
+    // line goes out where the caller expects it.
+    engine->Stop();
+
+    engine->SetClock(nullptr);
+    engine->SetSink(nullptr);
+    engine->SetTickObserver(nullptr);
+    engine->SetMetrics(nullptr);
+    engine->SetSuppressRedundantFrames(true);
+
+    // The free list's capacity only grows to the peak number of live sessions.
+    idle_[cellsOf_[engine]].push_back(engine);
+    stats_.live--;
+}
+
+} // namespace calibration
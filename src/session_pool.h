@@ -0,0 +1,68 @@
+#pragma once
+
+// Recycles calibration sessions (engines with their frame buffers) for
+// workloads that create and tear down many of them: conformance cases, test
+// plans, fleet simulations.
+//
+// Engines are constructed in place in chunked storage that only grows, and a
+// released engine goes onto a free list for its cell count with its buffers
+// still allocated. Acquiring a session of a geometry seen before is a pop, and
+// starting it does not allocate; releasing is a push. Nothing is freed before
+// the pool itself, so long runs do not fragment the heap. Not thread-safe:
+// use one pool per thread.
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+struct SessionPoolStats {
+    std::uint64_t created = 0;   // engines constructed
+    std::uint64_t reused = 0;    // acquisitions served from a free list
+    int live = 0;                // acquired and not yet released
+};
+
+class SessionPool {
+public:
+    SessionPool() = default;
+    SessionPool(const SessionPool&) = delete;
+    SessionPool& operator=(const SessionPool&) = delete;
+
+    // Returns an idle engine whose frame buffers hold at least `cells` cells.
+    // Clock, sink and hooks are unset; suppression of redundant frames is on.
+    Engine* Acquire(int cells);
+
+    // Stops the engine if needed, clears its hooks and keeps it for reuse.
+    void Release(Engine* engine);
+
+    const SessionPoolStats& Stats() const { return stats_; }
+
+private:
+    std::deque<Engine> storage_;                          // stable addresses
+    std::unordered_map<int, std::vector<Engine*>> idle_;  // by cell count
+    std::unordered_map<const Engine*, int> cellsOf_;      // geometry each engine was made for
+    SessionPoolStats stats_;
+};
+
+// Acquires on construction, releases on destruction.
+class PooledSession {
+public:
+    PooledSession(SessionPool& pool, int cells) : pool_(pool), engine_(pool.Acquire(cells)) {}
+    ~PooledSession() { pool_.Release(engine_); }
+
+    PooledSession(const PooledSession&) = delete;
+    PooledSession& operator=(const PooledSession&) = delete;
+
+    Engine& operator*() const { return *engine_; }
+    Engine* operator->() const { return engine_; }
+
+private:
+    SessionPool& pool_;
+    Engine* engine_;
+};
+
+} // namespace calibration
@@ -0,0 +1,940 @@
+// Headless calibration simulator.
+//
+// Runs the calibration engine against a virtual clock, so a pass that would
+// take hours at the configured interval completes in milliseconds with the
+// same frame/timestamp sequence as a real run. Useful for regression checks
+// and for estimating how long a plan takes on a given display.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "alloc_stats.h"
+#include "async_writer.h"
+#include "calibration_engine.h"
+#include "checkpoint.h"
+#include "conformance.h"
+#include "diff_bench.h"
+#include "e2e_bench.h"
+#include "explorer.h"
+#include "fault_sim.h"
+#include "fleet.h"
+#include "jitter.h"
+#include "metrics.h"
+#include "retest_sim.h"
+#include "rt_thread.h"
+#include "scheduler.h"
+#include "session_bench.h"
+#include "soak.h"
+#include "terminal_view.h"
+#include "trace.h"
+
+namespace {
+
+using calibration::Mode;
+
+enum class Command {
+    Run,
+    Conformance,        // check all combinations against the golden frame streams
+    ConformanceUpdate,  // print a fresh conformance_golden.inc
+    Explore,            // exhaustive state-machine exploration
+    BenchSessions,      // session ticks per second at fleet scale
+    BenchDiff,          // frame differ check and throughput
+    BenchE2E,           // commanded-to-shown latency through a simulated display
+    Fleet,              // many real-time sessions on one timer wheel
+    Jitter,             // tick lateness on a normal vs a real-time thread
+    Faults,             // detection probability of test plans against fault models
+    Retest,             // adaptive retest vs blind loops on faulty virtual displays
+};
+
+struct Options {
+    Command command = Command::Run;
+    calibration::Settings settings;
+    std::uint32_t seed = 1;
+    double durationSec = 3600.0;    // time budget (loop on never finishes by itself)
+    bool durationSet = false;
+    std::uint64_t maxTicks = 0;     // 0 = unlimited
+    bool printFrames = false;
+    bool keepRedundant = false;
+    bool realTime = false;
+    double stopAfterSec = -1.0;     // --realtime: request a stop from another thread
+    bool rt = false;                // --realtime on a pinned SCHED_FIFO thread
+    calibration::RealTimeConfig rtConfig;
+    const char* checkpointPath = nullptr;
+    double checkpointEverySec = 30.0; // run time between checkpoints
+    const char* resumePath = nullptr;
+    bool soak = false;              // loop the plan until the budget (default: forever)
+    calibration::SoakConfig soakConfig;
+    const char* soakLogPath = nullptr;
+    int soakLogMaxKb = 1024;
+    int soakLogFiles = 4;
+    const char* metricsPath = nullptr;
+    double metricsEverySec = 10.0;  // wall-clock period of the metrics file rewrite
+    const char* tracePath = nullptr;
+    bool json = false;              // run summary as JSON on stdout
+    int exploreCols = 12;
+    int exploreRows = 12;
+    int benchSessions = 10000;
+    int fleetSessions = 10000;
+    int workers = 0;                // conformance / fleet threads, 0 = one per hardware thread
+    int jitterIntervalMs = 1;
+    const char* faultPlans = nullptr;   // nullptr: the default plan set
+    int faultTrials = 1000;
+    double retestConfidence = 0.99;
+    int blindLoops = 3;
+    double neighbourHitRate = -1.0;     // --retest: < 0 keeps the RetestConfig default
+    bool readback = false;              // --retest: marks come from a readback, not an operator
+};
+
+std::string FormatDuration(std::int64_t us) {
+    const std::int64_t totalSec = us / 1000000;
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%lld:%02lld:%02lld.%03lld",
+        (long long)(totalSec / 3600), (long long)((totalSec / 60) % 60),
+        (long long)(totalSec % 60), (long long)((us / 1000) % 1000));
+    return buf;
+}
+
+// For JSON string values; escapes like the trace writer.
+std::string JsonEscaped(const std::string& s) {
+    std::string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+// Prints frames as "<microseconds> <braille line>". The line is formatted into
+// a reused buffer and handed to the writer thread, so the tick does no I/O.
+class PrintSink : public calibration::FrameSink {
+public:
+    explicit PrintSink(calibration::AsyncWriter& writer) : writer_(writer) {}
+
+    void WriteFrame(const std::wstring& line, std::int64_t timeUs) override {
+        char stamp[32];
+        const int n = std::snprintf(stamp, sizeof(stamp), "%lld ", (long long)timeUs);
+        text_.assign(stamp, (size_t)n);
+        calibration::AppendUtf8(line, text_);
+        text_ += '\n';
+        writer_.Append(text_.data(), text_.size());
+    }
+
+private:
+    calibration::AsyncWriter& writer_;
+    std::string text_;
+};
+
+void PrintUsage() {
+    std::printf(
+        "Usage: BrailleCalibrationSim [options]\n"
+        "  --cols N          columns (default 24)\n"
+        "  --rows N          rows (default 4)\n"
+        "  --interval MS     tick interval / ON time in ms (default 500)\n"
+        "  --off MS          OFF (blank) time in ms, 0 = no OFF phase (default = interval)\n"
+        "  --mode N          mode index 0..%d, same order as the dialog combo\n"
+        "  --whole-line      blink the whole line instead of walking\n"
+        "  --no-loop         stop after one pass\n"
+        "  --seed N          RNG seed for random modes (default 1)\n"
+        "  --duration SEC    time budget in seconds (default 3600, none with --ticks)\n"
+        "  --ticks N         stop after N ticks (virtual or --realtime)\n"
+        "  --frames          print every published frame with its timestamp\n"
+        "  --keep-redundant  re-send identical frames instead of skipping them\n"
+        "  --realtime        run on the wall clock (deadline scheduler) instead of\n"
+        "                    virtual time; reports lateness and staleness\n"
+        "  --stop-after SEC  with --realtime: send a stop request from another thread\n"
+        "                    after SEC seconds and report stop-to-blank latency\n"
+        "  --rt              real-time mode (implies --realtime): pin the runner to one\n"
+        "                    CPU, SCHED_FIFO, lock memory; falls back step by step\n"
+        "                    when not permitted\n"
+        "  --rt-cpu N        CPU for --rt (default: the last one available)\n"
+        "  --rt-priority N   SCHED_FIFO priority for --rt, 1..99 (default 50)\n"
+        "  --checkpoint FILE write the run state to FILE periodically (atomic replace)\n"
+        "  --checkpoint-every SEC\n"
+        "                    run time between checkpoints (default 30)\n"
+        "  --resume FILE     continue the run saved in FILE at its exact tick\n"
+        "                    (settings and seed come from the file)\n"
+        "\n"
+        "  --soak            burn-in: restart the plan whenever a pass ends and run until\n"
+        "                    --duration / --ticks / --stop-after (default: forever);\n"
+        "                    prints a one-line summary periodically, constant memory\n"
+        "  --soak-window SEC stats window for histograms and drift (default 3600)\n"
+        "  --report-every SEC  summary period (default 60)\n"
+        "  --log FILE        also write summaries to FILE, rotated at --log-max-kb\n"
+        "                    (default 1024) keeping --log-files files (default 4)\n"
+        "  --metrics FILE    export live counters as OpenMetrics text to FILE\n"
+        "  --metrics-every SEC  rewrite period in wall-clock seconds (default 10)\n"
+        "  --trace FILE      record the tick pipeline (wait, generate, write) and\n"
+        "                    write it as Chrome trace JSON (newest 65536 events)\n"
+        "  --json            print the run summary (timing, memory, allocations per\n"
+        "                    tick) as one JSON object on stdout\n"
+        "\n"
+        "  --conformance         run every mode/traversal/geometry combination and\n"
+        "                        compare against the golden frame-stream hashes\n"
+        "  --conformance-update  print a fresh golden table (conformance_golden.inc)\n"
+        "  --explore [C R]       check state-machine invariants for every mode and\n"
+        "                        geometry up to C x R (default 12 x 12)\n"
+        "  --bench-sessions [N]  session ticks per second for N sessions (default\n"
+        "                        10000): engines vs compact batched state\n"
+        "  --bench-diff          check the SSE2 frame differ against the scalar one\n"
+        "                        and compare their throughput\n"
+        "  --bench-e2e           end-to-end frame latency per pipeline stage into a\n"
+        "                        simulated terminal display, for several modes,\n"
+        "                        geometries and intervals, --duration seconds each\n"
+        "                        (default 0.5); --json for machine-readable output,\n"
+        "                        --rt to run the pipeline in real-time mode\n"
+        "  --fleet [N]           run N sessions (default 10000) with mixed intervals in\n"
+        "                        real time on one timer wheel for --duration seconds\n"
+        "                        (default 10); reports wake-to-dispatch latency\n"
+        "  --jitter [MS]         tick lateness histograms on a normal and on an --rt\n"
+        "                        thread, MS interval without OFF phase (default 1),\n"
+        "                        --duration seconds each (default 5)\n"
+        "  --faults [PLANS]      Monte Carlo: inject stuck-up, stuck-down, slow-rise,\n"
+        "                        crosstalk and intermittent pins into virtual displays\n"
+        "                        and report detection probability and time to detect\n"
+        "                        per plan; PLANS like 0,3,0+3w (mode indices, + joins\n"
+        "                        steps, w = whole line; default: every mode); geometry\n"
+        "                        and timing from --cols/--rows/--interval/--off\n"
+        "  --trials N            virtual displays per plan and fault model (default 1000)\n"
+        "  --retest              adaptive retest (repeat passes over suspicious cells and\n"
+        "                        their neighbours, sequential test per cell) against\n"
+        "                        --blind-loops N full passes (default 3), on virtual\n"
+        "                        displays with one faulty pin each; walking modes only\n"
+        "  --confidence P        --retest: pass/fail a unit at this confidence (default 0.99)\n"
+        "  --readback            --retest: marks come from a pin readback instead of an\n"
+        "                        operator (every wrong pin seen, hardly any false marks)\n"
+        "  --neighbour-hit P     --retest: how much a clean showing clears the cells next to\n"
+        "                        it (default 0: only a cell's own showings count; faults\n"
+        "                        on a single cell go unseen as P grows)\n"
+        "  --workers N           threads for --conformance, --faults, --retest and --fleet\n"
+        "                        frame generation (default: one per hardware thread)\n",
+        calibration::kModeCount - 1);
+}
+
+bool ParseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const bool hasValue = (i + 1 < argc);
+
+        if (!std::strcmp(a, "--cols") && hasValue) opt.settings.cols = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--rows") && hasValue) opt.settings.rows = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--interval") && hasValue) opt.settings.intervalMs = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--off") && hasValue) opt.settings.offMs = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--mode") && hasValue) opt.settings.mode = (Mode)std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--whole-line")) opt.settings.wholeLine = true;
+        else if (!std::strcmp(a, "--no-loop")) opt.settings.loop = false;
+        else if (!std::strcmp(a, "--seed") && hasValue) opt.seed = (std::uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--duration") && hasValue) { opt.durationSec = std::atof(argv[++i]); opt.durationSet = true; }
+        else if (!std::strcmp(a, "--ticks") && hasValue) opt.maxTicks = std::strtoull(argv[++i], nullptr, 10);
+        else if (!std::strcmp(a, "--frames")) opt.printFrames = true;
+        else if (!std::strcmp(a, "--keep-redundant")) opt.keepRedundant = true;
+        else if (!std::strcmp(a, "--realtime")) opt.realTime = true;
+        else if (!std::strcmp(a, "--rt")) { opt.rt = true; opt.realTime = true; }
+        else if (!std::strcmp(a, "--rt-cpu") && hasValue) opt.rtConfig.cpu = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--rt-priority") && hasValue) opt.rtConfig.priority = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--stop-after") && hasValue) opt.stopAfterSec = std::atof(argv[++i]);
+        else if (!std::strcmp(a, "--checkpoint") && hasValue) opt.checkpointPath = argv[++i];
+        else if (!std::strcmp(a, "--checkpoint-every") && hasValue) opt.checkpointEverySec = std::atof(argv[++i]);
+        else if (!std::strcmp(a, "--resume") && hasValue) opt.resumePath = argv[++i];
+        else if (!std::strcmp(a, "--soak")) opt.soak = true;
+        else if (!std::strcmp(a, "--soak-window") && hasValue) opt.soakConfig.windowUs = (std::int64_t)(std::atof(argv[++i]) * 1e6);
+        else if (!std::strcmp(a, "--report-every") && hasValue) opt.soakConfig.reportEveryUs = (std::int64_t)(std::atof(argv[++i]) * 1e6);
+        else if (!std::strcmp(a, "--log") && hasValue) opt.soakLogPath = argv[++i];
+        else if (!std::strcmp(a, "--log-max-kb") && hasValue) opt.soakLogMaxKb = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--log-files") && hasValue) opt.soakLogFiles = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--metrics") && hasValue) opt.metricsPath = argv[++i];
+        else if (!std::strcmp(a, "--metrics-every") && hasValue) opt.metricsEverySec = std::atof(argv[++i]);
+        else if (!std::strcmp(a, "--trace") && hasValue) opt.tracePath = argv[++i];
+        else if (!std::strcmp(a, "--json")) opt.json = true;
+        else if (!std::strcmp(a, "--workers") && hasValue) opt.workers = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--conformance")) opt.command = Command::Conformance;
+        else if (!std::strcmp(a, "--conformance-update")) opt.command = Command::ConformanceUpdate;
+        else if (!std::strcmp(a, "--explore")) {
+            opt.command = Command::Explore;
+            if (i + 2 < argc && argv[i + 1][0] != '-') {
+                opt.exploreCols = std::atoi(argv[++i]);
+                opt.exploreRows = std::atoi(argv[++i]);
+                if (opt.exploreCols <= 0 || opt.exploreRows <= 0) return false;
+            }
+        }
+        else if (!std::strcmp(a, "--bench-sessions")) {
+            opt.command = Command::BenchSessions;
+            if (hasValue && argv[i + 1][0] != '-') {
+                opt.benchSessions = std::atoi(argv[++i]);
+                if (opt.benchSessions <= 0) return false;
+            }
+        }
+        else if (!std::strcmp(a, "--bench-diff")) opt.command = Command::BenchDiff;
+        else if (!std::strcmp(a, "--bench-e2e")) opt.command = Command::BenchE2E;
+        else if (!std::strcmp(a, "--jitter")) {
+            opt.command = Command::Jitter;
+            if (hasValue && argv[i + 1][0] != '-') {
+                opt.jitterIntervalMs = std::atoi(argv[++i]);
+                if (opt.jitterIntervalMs <= 0) return false;
+            }
+        }
+        else if (!std::strcmp(a, "--faults")) {
+            opt.command = Command::Faults;
+            if (hasValue && argv[i + 1][0] != '-') opt.faultPlans = argv[++i];
+        }
+        else if (!std::strcmp(a, "--trials") && hasValue) {
+            opt.faultTrials = std::atoi(argv[++i]);
+            if (opt.faultTrials <= 0) return false;
+        }
+        else if (!std::strcmp(a, "--retest")) opt.command = Command::Retest;
+        else if (!std::strcmp(a, "--confidence") && hasValue) opt.retestConfidence = std::atof(argv[++i]);
+        else if (!std::strcmp(a, "--blind-loops") && hasValue) opt.blindLoops = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--readback")) opt.readback = true;
+        else if (!std::strcmp(a, "--neighbour-hit") && hasValue) opt.neighbourHitRate = std::atof(argv[++i]);
+        else if (!std::strcmp(a, "--fleet")) {
+            opt.command = Command::Fleet;
+            if (hasValue && argv[i + 1][0] != '-') {
+                opt.fleetSessions = std::atoi(argv[++i]);
+                if (opt.fleetSessions <= 0) return false;
+            }
+        }
+        else return false;
+    }
+
+    const calibration::Settings& s = opt.settings;
+    if (s.cols <= 0 || s.rows <= 0 || s.intervalMs <= 0) return false;
+    if (1LL * s.cols * s.rows > 5000) return false;
+    if ((int)s.mode < 0 || (int)s.mode >= calibration::kModeCount) return false;
+    if (opt.checkpointEverySec <= 0) return false;
+    if (opt.soakConfig.windowUs <= 0 || opt.soakConfig.reportEveryUs <= 0) return false;
+    if (opt.soakLogMaxKb <= 0 || opt.soakLogFiles <= 0) return false;
+    if (opt.metricsEverySec <= 0) return false;
+    if (opt.rtConfig.priority < 1 || opt.rtConfig.priority > 99) return false;
+    if (opt.retestConfidence <= 0.5 || opt.retestConfidence >= 1.0 || opt.blindLoops <= 0) return false;
+    if (opt.neighbourHitRate >= 1.0) return false;
+    if (opt.stopAfterSec >= 0 && !opt.realTime) {
+        std::fprintf(stderr, "--stop-after needs --realtime (the virtual clock has no other thread)\n");
+        return false;
+    }
+    return true;
+}
+
+int RunConformanceCommand(const Options& opt) {
+    const auto realStart = std::chrono::steady_clock::now();
+    const calibration::ConformanceReport report = calibration::RunConformance(stdout, opt.workers);
+    const auto realUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - realStart).count();
+
+    std::printf("conformance: %d cases (%d with golden hash), %llu frames, %d failed, %.1fms "
+        "(sessions: %llu created, %llu reused; %d workers, %llu steals)\n",
+        report.cases, report.goldenChecked, (unsigned long long)report.frames,
+        report.failed, realUs / 1000.0,
+        (unsigned long long)report.sessionsCreated, (unsigned long long)report.sessionsReused,
+        report.workers, (unsigned long long)report.steals);
+    return report.failed ? 1 : 0;
+}
+
+int RunExploreCommand(const Options& opt) {
+    const auto realStart = std::chrono::steady_clock::now();
+    const calibration::ExploreReport report =
+        calibration::ExploreStateSpace(opt.exploreCols, opt.exploreRows, stdout);
+    const auto realUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - realStart).count();
+
+    const double seconds = realUs / 1e6;
+    std::printf("explore: %d combinations up to %dx%d, %llu steps, %d violations, "
+        "%d free-running (random groupings ignore loop), %.1fms (%.1fM steps/s)\n",
+        report.combinations, opt.exploreCols, opt.exploreRows,
+        (unsigned long long)report.steps, report.violations, report.freeRunning,
+        realUs / 1000.0, seconds > 0 ? report.steps / seconds / 1e6 : 0.0);
+    return report.violations ? 1 : 0;
+}
+
+int RunBenchSessionsCommand(const Options& opt) {
+    const calibration::SessionBenchReport report =
+        calibration::RunSessionBenchmark(opt.benchSessions, 1.0, stdout);
+
+    std::printf("bench-sessions: %d sessions, %d mismatches against the engine; bytes per session: "
+        "engine %zu, struct %zu, batch hot state %zu\n",
+        report.sessions, report.mismatches, report.engineBytes, report.structBytes, report.hotBytes);
+    for (const calibration::SessionBenchResult& r : report.results) {
+        std::printf("  %-40s %9.1fM session ticks/s\n", r.name, r.PerSecond() / 1e6);
+    }
+    return report.mismatches ? 1 : 0;
+}
+
+int RunBenchDiffCommand() {
+    const calibration::DiffBenchReport report = calibration::RunDiffBenchmark(0.5, stdout);
+
+    std::printf("bench-diff: %d frame pairs, %d mismatches against the scalar differ\n",
+        report.pairsChecked, report.mismatches);
+    for (const calibration::DiffBenchResult& r : report.results) {
+        std::printf("  %-20s %4d spans  scalar %6.1f GB/s  sse2 %6.1f GB/s\n",
+            r.name, r.spans, r.scalarGBs, r.simdGBs);
+    }
+    return report.mismatches ? 1 : 0;
+}
+
+int RunBenchE2ECommand(const Options& opt) {
+    const double seconds = opt.durationSet ? opt.durationSec : 0.5;
+    const calibration::E2EReport report =
+        calibration::RunEndToEndBenchmark(seconds, opt.rt ? &opt.rtConfig : nullptr);
+
+    std::uint64_t failures = 0;
+    for (const calibration::E2ECase& c : report.cases) failures += c.missing + c.mismatches;
+
+    if (opt.json) {
+        std::printf("{\"benchmark\":\"e2e\",\"display\":\"terminal emulator over a pipe\","
+            "\"secondsPerCase\":%.3f,\"realTime\":%s,\"cases\":[",
+            seconds, opt.rt ? ("\"" + calibration::DescribeRealTime(report.rt) + "\"").c_str() : "null");
+        for (size_t i = 0; i < report.cases.size(); ++i) {
+            const calibration::E2ECase& c = report.cases[i];
+            const calibration::Settings& s = c.settings;
+            std::printf("%s{\"pattern\":\"%s\",\"mode\":%d,\"wholeLine\":%s,\"cols\":%d,\"rows\":%d,"
+                "\"onMs\":%d,\"offMs\":%d,\"frames\":%llu,\"missing\":%llu,\"mismatches\":%llu,"
+                "\"bytes\":%llu,\"stagesUs\":{",
+                i ? "," : "", c.pattern, (int)s.mode, s.wholeLine ? "true" : "false", s.cols, s.rows,
+                s.intervalMs, s.OffDurationMs(), (unsigned long long)c.frames,
+                (unsigned long long)c.missing, (unsigned long long)c.mismatches,
+                (unsigned long long)c.bytes);
+            for (size_t k = 0; k < c.stages.size(); ++k) {
+                const calibration::E2EStage& st = c.stages[k];
+                std::printf("%s\"%s\":{\"mean\":%.3f,\"p50\":%lld,\"p90\":%lld,\"p99\":%lld,"
+                    "\"p999\":%lld,\"max\":%lld}",
+                    k ? "," : "", st.name, st.meanUs, (long long)st.p50Us, (long long)st.p90Us,
+                    (long long)st.p99Us, (long long)st.p999Us, (long long)st.maxUs);
+            }
+            std::printf("}}");
+        }
+        std::printf("]}\n");
+        return failures ? 1 : 0;
+    }
+
+    std::printf("bench-e2e: %zu cases, %.3gs each, terminal emulator over a pipe%s%s\n",
+        report.cases.size(), seconds, opt.rt ? "; rt: " : "",
+        opt.rt ? calibration::DescribeRealTime(report.rt).c_str() : "");
+    std::printf("  %-18s %-6s %4s %6s  %-17s %-17s %-17s %-17s %s\n", "pattern", "cells", "ms", "frames",
+        "total p50/p99/max", "dispatch p50/p99", "encode p50/p99", "transport p50/p99", "lost");
+    for (const calibration::E2ECase& c : report.cases) {
+        char cells[16];
+        std::snprintf(cells, sizeof(cells), "%dx%d", c.settings.cols, c.settings.rows);
+        const calibration::E2EStage* stage[4] = { nullptr, nullptr, nullptr, nullptr };
+        const char* names[4] = { "total", "dispatch", "encode", "transport" };
+        for (const calibration::E2EStage& st : c.stages) {
+            for (int k = 0; k < 4; ++k) {
+                if (!std::strcmp(st.name, names[k])) stage[k] = &st;
+            }
+        }
+        char columns[4][32];
+        for (int k = 0; k < 4; ++k) {
+            const calibration::E2EStage empty;
+            const calibration::E2EStage& st = stage[k] ? *stage[k] : empty;
+            if (k == 0) {
+                std::snprintf(columns[k], sizeof(columns[k]), "%lld/%lld/%lldus",
+                    (long long)st.p50Us, (long long)st.p99Us, (long long)st.maxUs);
+            } else {
+                std::snprintf(columns[k], sizeof(columns[k]), "%lld/%lldus",
+                    (long long)st.p50Us, (long long)st.p99Us);
+            }
+        }
+        std::printf("  %-18s %-6s %4d %6llu  %-17s %-17s %-17s %-17s %llu\n", c.pattern, cells,
+            c.settings.intervalMs, (unsigned long long)c.frames, columns[0], columns[1], columns[2],
+            columns[3], (unsigned long long)(c.missing + c.mismatches));
+    }
+    return failures ? 1 : 0;
+}
+
+std::string JitterBucketLabel(int bucket) {
+    if (bucket == 0) return "0us";
+    return "<" + std::to_string(1LL << bucket) + "us";
+}
+
+int RunJitterCommand(const Options& opt) {
+    calibration::Settings s = opt.settings;
+    s.intervalMs = opt.jitterIntervalMs;
+    s.offMs = 0;
+    const double seconds = opt.durationSet ? opt.durationSec : 5.0;
+
+    const calibration::JitterReport r = calibration::RunJitterComparison(s, seconds, opt.rtConfig);
+    std::printf("jitter: %dms ticks, %.1fs per pass; real-time pass: %s\n",
+        s.intervalMs, seconds, calibration::DescribeRealTime(r.realTime.rt).c_str());
+
+    const calibration::LatencyHistogram& a = r.normal.lateness;
+    const calibration::LatencyHistogram& b = r.realTime.lateness;
+    int first = calibration::LatencyHistogram::kBuckets;
+    int last = -1;
+    for (int k = 0; k < calibration::LatencyHistogram::kBuckets; ++k) {
+        if (a.BucketCount(k) || b.BucketCount(k)) {
+            first = std::min(first, k);
+            last = k;
+        }
+    }
+
+    std::printf("  %-10s %12s %12s\n", "lateness", "normal", "real-time");
+    for (int k = first; k <= last; ++k) {
+        std::printf("  %-10s %12llu %12llu\n", JitterBucketLabel(k).c_str(),
+            (unsigned long long)a.BucketCount(k), (unsigned long long)b.BucketCount(k));
+    }
+    std::printf("  %-10s %12llu %12llu\n", "ticks",
+        (unsigned long long)r.normal.ticks, (unsigned long long)r.realTime.ticks);
+    const double ps[3] = { 0.50, 0.99, 0.999 };
+    const char* names[3] = { "p50", "p99", "p99.9" };
+    for (int i = 0; i < 3; ++i) {
+        std::printf("  %-10s %10lldus %10lldus\n", names[i],
+            (long long)a.PercentileUs(ps[i]), (long long)b.PercentileUs(ps[i]));
+    }
+    std::printf("  %-10s %10lldus %10lldus\n", "max", (long long)a.MaxUs(), (long long)b.MaxUs());
+    return 0;
+}
+
+int RunFaultsCommand(const Options& opt) {
+    std::vector<calibration::FaultPlan> plans;
+    if (!opt.faultPlans) {
+        plans = calibration::DefaultFaultPlans(opt.settings);
+    } else if (!calibration::ParseFaultPlans(opt.faultPlans, opt.settings, plans)) {
+        std::fprintf(stderr, "cannot parse plans \"%s\" (expected e.g. 0,3,0+3w)\n", opt.faultPlans);
+        return 2;
+    }
+
+    calibration::FaultConfig config;
+    config.trials = opt.faultTrials;
+    config.workers = opt.workers;
+    config.seed = opt.seed;
+
+    const auto realStart = std::chrono::steady_clock::now();
+    const calibration::FaultReport report = calibration::RunFaultSimulation(plans, config);
+    const auto realUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - realStart).count();
+
+    if (opt.json) {
+        std::printf("{\"cols\":%d,\"rows\":%d,\"onMs\":%d,\"offMs\":%d,\"trials\":%d,"
+            "\"noticeProbability\":%.3f,\"minVisibleMs\":%d,\"plans\":[",
+            opt.settings.cols, opt.settings.rows, opt.settings.intervalMs, opt.settings.OffDurationMs(),
+            config.trials, config.noticeProbability, config.minVisibleMs);
+        for (size_t p = 0; p < report.plans.size(); ++p) {
+            const calibration::FaultPlanResult& r = report.plans[p];
+            std::printf("%s{\"plan\":\"%s\",\"description\":\"%s\",\"lengthUs\":%lld,\"frames\":%llu,"
+                "\"detection\":%.4f,\"detectedPerMinute\":%.4f,\"faults\":{",
+                p ? "," : "", JsonEscaped(r.name).c_str(), JsonEscaped(r.description).c_str(), (long long)r.lengthUs,
+                (unsigned long long)r.frames, r.Probability(), r.DetectedPerMinute());
+            for (int m = 0; m < calibration::kFaultModelCount; ++m) {
+                const calibration::FaultModelResult& fm = r.models[m];
+                std::printf("%s\"%s\":{\"trials\":%d,\"detected\":%d,\"probability\":%.4f,"
+                    "\"meanDetectUs\":%.0f,\"p50DetectUs\":%lld,\"p90DetectUs\":%lld}",
+                    m ? "," : "", calibration::FaultModelName((calibration::FaultModel)m), fm.trials,
+                    fm.detected, fm.Probability(), fm.meanDetectUs, (long long)fm.p50DetectUs,
+                    (long long)fm.p90DetectUs);
+            }
+            std::printf("}}");
+        }
+        std::printf("]}\n");
+        return 0;
+    }
+
+    std::printf("faults: %zu plans x %d fault models x %d displays on %dx%d, %dms on / %dms off, "
+        "%d workers, %.1fms\n",
+        report.plans.size(), calibration::kFaultModelCount, config.trials,
+        opt.settings.cols, opt.settings.rows, opt.settings.intervalMs, opt.settings.OffDurationMs(),
+        report.workers, realUs / 1000.0);
+    std::printf("  detected %% / median seconds to detect; operator notices a wrong pin shown for\n"
+        "  >= %dms with probability %.2f, random frames only when blank\n",
+        config.minVisibleMs, config.noticeProbability);
+    std::printf("  %-6s %-48s %8s", "plan", "", "length");
+    for (int m = 0; m < calibration::kFaultModelCount; ++m) {
+        std::printf(" %13s", calibration::FaultModelName((calibration::FaultModel)m));
+    }
+    std::printf(" %6s %7s\n", "all", "per min");
+    for (const calibration::FaultPlanResult& r : report.plans) {
+        std::printf("  %-6s %-48.48s %7.1fs", r.name.c_str(), r.description.c_str(), r.lengthUs / 1e6);
+        for (const calibration::FaultModelResult& fm : r.models) {
+            char cell[32];
+            if (fm.detected) {
+                std::snprintf(cell, sizeof(cell), "%3.0f%% %6.1fs", 100.0 * fm.Probability(), fm.p50DetectUs / 1e6);
+            } else {
+                std::snprintf(cell, sizeof(cell), "%3.0f%%       -", 0.0);
+            }
+            std::printf(" %13s", cell);
+        }
+        std::printf(" %5.0f%% %7.2f\n", 100.0 * r.Probability(), r.DetectedPerMinute());
+    }
+    return 0;
+}
+
+int RunRetestCommand(const Options& opt) {
+    if (!calibration::RetestModeSupported(opt.settings)) {
+        std::fprintf(stderr, "--retest needs a walking mode (not random groupings, no --whole-line)\n");
+        return 2;
+    }
+
+    calibration::RetestSimConfig config;
+    config.settings = opt.settings;
+    config.blindLoops = opt.blindLoops;
+    config.faults.trials = opt.faultTrials;
+    config.faults.workers = opt.workers;
+    config.faults.seed = opt.seed;
+    config.retest.confidence = opt.retestConfidence;
+    if (opt.readback) {
+        config.faults.noticeProbability = 1.0;
+        config.retest.hitRate = 0.95;
+        config.retest.falseMarkRate = 0.0001;
+    }
+    if (opt.neighbourHitRate >= 0.0) config.retest.neighbourHitRate = opt.neighbourHitRate;
+
+    const auto realStart = std::chrono::steady_clock::now();
+    const calibration::RetestSimReport report = calibration::RunRetestComparison(config);
+    const auto realUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - realStart).count();
+
+    const calibration::Settings& s = opt.settings;
+    if (opt.json) {
+        std::printf("{\"mode\":%d,\"cols\":%d,\"rows\":%d,\"onMs\":%d,\"offMs\":%d,\"observer\":\"%s\","
+            "\"confidence\":%.4f,\"blindLoops\":%d,\"unitsPerCase\":%d,\"passUs\":%lld,\"cases\":[",
+            (int)s.mode, s.cols, s.rows, s.intervalMs, s.OffDurationMs(), opt.readback ? "readback" : "operator",
+            config.retest.confidence, config.blindLoops, config.faults.trials, (long long)report.passUs);
+        for (size_t i = 0; i < report.cases.size(); ++i) {
+            const calibration::RetestCaseResult& c = report.cases[i];
+            std::printf("%s{\"fault\":\"%s\",\"adaptive\":{\"failed\":%d,\"undecided\":%d,"
+                "\"meanTimeUs\":%.0f,\"meanPasses\":%.3f,\"meanShowings\":%.1f},"
+                "\"blind\":{\"failed\":%d,\"timeUs\":%.0f}}",
+                i ? "," : "", c.name, c.adaptive.failed, c.adaptive.undecided, c.adaptive.meanTimeUs,
+                c.adaptive.meanPasses, c.adaptive.meanShowings, c.blind.failed, c.blind.meanTimeUs);
+        }
+        std::printf("]}\n");
+        return 0;
+    }
+
+    std::printf("retest: mode %d on %dx%d, %dms on / %dms off, %s marks, confidence %.3f; "
+        "%d units per case, %d workers, %.1fms\n",
+        (int)s.mode, s.cols, s.rows, s.intervalMs, s.OffDurationMs(), opt.readback ? "readback" : "operator",
+        config.retest.confidence, config.faults.trials, report.workers, realUs / 1000.0);
+    std::printf("  full pass %.1fs; blind: %d passes, any mark fails the unit\n",
+        report.passUs / 1e6, config.blindLoops);
+    std::printf("  %-14s %22s %10s %8s %10s   %16s\n", "fault", "adaptive failed", "time", "passes",
+        "cells", "blind failed");
+    for (const calibration::RetestCaseResult& c : report.cases) {
+        char undecided[24] = "";
+        if (c.adaptive.undecided) std::snprintf(undecided, sizeof(undecided), " (%d undec.)", c.adaptive.undecided);
+        std::printf("  %-14s %5.1f%%%-16s %9.1fs %8.2f %10.1f   %15.1f%%\n", c.name,
+            100.0 * c.adaptive.FailRate(), undecided, c.adaptive.meanTimeUs / 1e6, c.adaptive.meanPasses,
+            c.adaptive.meanShowings, 100.0 * c.blind.FailRate());
+    }
+    const calibration::RetestCaseResult& good = report.cases.front();
+    double adaptiveFound = 0.0, blindFound = 0.0;
+    const size_t faultCases = report.cases.size() - 1;
+    for (size_t i = 1; i < report.cases.size(); ++i) {
+        adaptiveFound += report.cases[i].adaptive.FailRate();
+        blindFound += report.cases[i].blind.FailRate();
+    }
+    std::printf("  good unit: adaptive %.1fs vs blind %.1fs (%.0f%%), failed %.1f%% vs %.1f%%; "
+        "faults found: adaptive %.1f%% vs blind %.1f%%\n",
+        good.adaptive.meanTimeUs / 1e6, good.blind.meanTimeUs / 1e6,
+        good.blind.meanTimeUs > 0 ? 100.0 * good.adaptive.meanTimeUs / good.blind.meanTimeUs : 0.0,
+        100.0 * good.adaptive.FailRate(), 100.0 * good.blind.FailRate(),
+        faultCases ? 100.0 * adaptiveFound / faultCases : 0.0, faultCases ? 100.0 * blindFound / faultCases : 0.0);
+    return 0;
+}
+
+int RunFleetCommand(const Options& opt) {
+    calibration::FleetConfig config;
+    config.sessions = opt.fleetSessions;
+    config.workers = opt.workers;
+    if (opt.durationSet) config.seconds = opt.durationSec;
+
+    const calibration::FleetReport r = calibration::RunFleet(config);
+    std::printf("fleet: %d sessions for %.1fs, %lldus slots: %llu ticks in %llu wake-ups "
+        "(%.1f per wake-up, max %d)\n",
+        config.sessions, config.seconds, (long long)config.resolutionUs,
+        (unsigned long long)r.ticks, (unsigned long long)r.wakes,
+        r.wakes ? (double)r.ticks / (double)r.wakes : 0.0, r.maxBatch);
+
+    const calibration::LatencyHistogram* rows[2] = { &r.wakeToDispatch, &r.lateness };
+    const char* names[2] = { "wake to dispatch", "deadline to dispatch" };
+    for (int i = 0; i < 2; ++i) {
+        std::printf("  %-22s p50 %lldus, p99 %lldus, max %lldus\n", names[i],
+            (long long)rows[i]->PercentileUs(0.50), (long long)rows[i]->PercentileUs(0.99),
+            (long long)rows[i]->MaxUs());
+    }
+    std::printf("  timer queue (virtual time, %llu expiries): wheel %.1fM/s, binary heap %.1fM/s\n",
+        (unsigned long long)r.queueExpiries,
+        r.wheelSeconds > 0 ? r.queueExpiries / r.wheelSeconds / 1e6 : 0.0,
+        r.heapSeconds > 0 ? r.queueExpiries / r.heapSeconds / 1e6 : 0.0);
+    if (r.queueMismatchAt >= 0) {
+        std::printf("  MISMATCH: wheel and heap expiries differ at expiry %lld\n", (long long)r.queueMismatchAt);
+    }
+
+    std::printf("  frame generation: %llu of %llu batches on %d workers (%.1fms in pooled batches)\n",
+        (unsigned long long)r.pooledBatches, (unsigned long long)r.wakes, (int)r.workers.size(),
+        r.poolBatchUs / 1000.0);
+    for (size_t w = 0; w < r.workers.size(); ++w) {
+        const calibration::WorkerStats& ws = r.workers[w];
+        std::printf("    worker %zu: %llu chunks, %llu stolen, %.0f%% busy\n", w,
+            (unsigned long long)ws.chunks, (unsigned long long)ws.steals,
+            r.poolBatchUs > 0 ? 100.0 * (double)ws.busyUs / (double)r.poolBatchUs : 0.0);
+    }
+    return r.queueMismatchAt >= 0 ? 1 : 0;
+}
+
+// Periodic checkpoints from the runner, virtual or real time. Only the snapshot
+// is taken here; CheckpointWriter serializes and writes on its own thread.
+class CheckpointHook : public calibration::RunnerHook {
+public:
+    CheckpointHook(calibration::CheckpointWriter& writer, const calibration::Clock& clock, std::int64_t everyUs)
+        : writer_(writer), clock_(clock), everyUs_(everyUs), lastUs_(clock.NowUs()) {}
+
+    void AfterTick(calibration::Engine& engine) override {
+        if (!engine.Running() || clock_.NowUs() - lastUs_ < everyUs_) return;
+        writer_.Submit(engine.Snapshot());
+        lastUs_ = clock_.NowUs();
+    }
+
+private:
+    calibration::CheckpointWriter& writer_;
+    const calibration::Clock& clock_;
+    std::int64_t everyUs_;
+    std::int64_t lastUs_;
+};
+
+int RunCommand(const Options& opt) {
+    calibration::VirtualClock virtualClock;
+    calibration::SteadyClock steadyClock;
+    const calibration::Clock& clock = opt.realTime
+        ? static_cast<const calibration::Clock&>(steadyClock)
+        : static_cast<const calibration::Clock&>(virtualClock);
+    std::unique_ptr<calibration::AsyncWriter> frameWriter;
+    std::unique_ptr<PrintSink> printSink;
+    if (opt.printFrames) {
+        frameWriter.reset(new calibration::AsyncWriter(stdout));
+        printSink.reset(new PrintSink(*frameWriter));
+    }
+
+    calibration::Engine engine;
+    engine.SetClock(&clock);
+    engine.SetSink(printSink.get());
+    engine.SetSuppressRedundantFrames(!opt.keepRedundant);
+
+    // Declared before the exporter, which writes a final file when it goes away.
+    calibration::MetricsRegistry metricsRegistry;
+    calibration::SessionMetrics metrics("sim");
+    std::unique_ptr<calibration::MetricsFileExporter> metricsExporter;
+    if (opt.metricsPath) {
+        engine.SetMetrics(&metrics);
+        metricsRegistry.Add(&metrics);
+        metricsExporter.reset(new calibration::MetricsFileExporter(
+            metricsRegistry, opt.metricsPath, (std::int64_t)(opt.metricsEverySec * 1000)));
+    }
+
+    std::unique_ptr<calibration::CheckpointWriter> checkpoints;
+    std::unique_ptr<CheckpointHook> checkpointHook;
+    if (opt.checkpointPath) {
+        checkpoints.reset(new calibration::CheckpointWriter(opt.checkpointPath));
+        checkpointHook.reset(new CheckpointHook(*checkpoints, clock, (std::int64_t)(opt.checkpointEverySec * 1e6)));
+    }
+
+    if (opt.tracePath) {
+        calibration::EnableTrace(true);
+        calibration::SetTraceThreadName(opt.realTime ? "runner" : "virtual runner");
+    }
+
+    const auto realStart = std::chrono::steady_clock::now();
+
+    if (opt.resumePath) {
+        calibration::EngineSnapshot snapshot;
+        if (!calibration::LoadCheckpoint(opt.resumePath, snapshot)) {
+            std::fprintf(stderr, "cannot resume: %s is missing or not a valid checkpoint\n", opt.resumePath);
+            return 1;
+        }
+        engine.Resume(snapshot);
+    } else {
+        engine.Start(opt.settings, opt.seed);
+    }
+    // Soak summaries are formatted and written on the reporter's thread.
+    std::unique_ptr<calibration::RollingLog> soakLog;
+    std::unique_ptr<calibration::SoakReporter> soakReporter;
+    std::unique_ptr<calibration::SoakMonitor> soakMonitor;
+    if (opt.soak) {
+        if (opt.soakLogPath) {
+            soakLog.reset(new calibration::RollingLog(opt.soakLogPath, 1024LL * opt.soakLogMaxKb, opt.soakLogFiles));
+        }
+        soakReporter.reset(new calibration::SoakReporter(stderr, soakLog.get()));
+        soakMonitor.reset(new calibration::SoakMonitor(opt.soakConfig, soakReporter.get()));
+        engine.SetTickObserver(soakMonitor.get());
+    }
+
+    // --ticks alone is the budget; soak without one runs until stopped.
+    const bool unlimited = !opt.durationSet && (opt.soak || opt.maxTicks);
+    const std::int64_t endUs = unlimited
+        ? std::numeric_limits<std::int64_t>::max()
+        : engine.GetStats().startUs + (std::int64_t)(opt.durationSec * 1e6);
+
+    calibration::RunnerCommands commands;
+    std::thread stopper;
+    if (opt.realTime && opt.stopAfterSec >= 0) {
+        stopper = std::thread([&] {
+            std::this_thread::sleep_for(std::chrono::microseconds((std::int64_t)(opt.stopAfterSec * 1e6)));
+            commands.RequestStop(steadyClock);
+        });
+    }
+
+    // After the first frame, so the frame buffers are written and get locked.
+    calibration::RealTimeStatus rtStatus;
+    if (opt.rt) {
+        rtStatus = calibration::EnterRealTime(opt.rtConfig);
+        std::fprintf(stderr, "rt: %s\n", calibration::DescribeRealTime(rtStatus).c_str());
+    }
+
+    std::uint32_t seed = engine.Seed();
+    std::uint64_t ticksBefore = 0;  // earlier soak passes
+    std::uint64_t passes = 0;
+
+    for (;;) {
+        if (opt.realTime) {
+            // Soak passes restart the engine's count; the budget covers them all.
+            const std::uint64_t maxTicks = opt.maxTicks ? opt.maxTicks - ticksBefore : 0;
+            calibration::RunRealTime(engine, steadyClock, commands, endUs, maxTicks, checkpointHook.get());
+        } else {
+            while (engine.Running()) {
+                if (engine.NextTickUs() > endUs) break;
+                if (opt.maxTicks && ticksBefore + engine.GetStats().ticks >= opt.maxTicks) break;
+
+                // Same wake/build/publish sequence as the real-time runner.
+                virtualClock.AdvanceTo(engine.NextWakeUs());
+                engine.PrepareTick();
+                virtualClock.AdvanceTo(engine.NextTickUs());
+                engine.Tick();
+                if (checkpointHook) checkpointHook->AfterTick(engine);
+            }
+        }
+
+        // Soak: a finished pass (loop off) starts over with the next seed.
+        if (!opt.soak || engine.Running()) break;
+        if (commands.stop.load(std::memory_order_acquire) || clock.NowUs() >= endUs) break;
+        if (opt.maxTicks && ticksBefore + engine.GetStats().ticks >= opt.maxTicks) break;
+
+        passes++;
+        soakMonitor->OnPassFinished();
+        ticksBefore += engine.GetStats().ticks;
+        engine.Start(engine.GetSettings(), ++seed);
+    }
+    if (stopper.joinable()) stopper.join();
+    if (opt.rt) calibration::LeaveRealTime(rtStatus);
+
+    if (soakMonitor) {
+        soakMonitor->Finish();
+        soakReporter.reset(); // drain before the summary below
+    }
+
+    const bool finished = !engine.Running();
+    engine.Stop();
+    if (frameWriter) frameWriter->Flush(); // frames before anything else on stdout
+
+    const auto realUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - realStart).count();
+
+    const calibration::Stats& st = engine.GetStats();
+    const calibration::Settings& s = engine.GetSettings();
+
+    std::fprintf(stderr,
+        "mode=%d (%s) cells=%dx%d=%d on=%dms off=%dms loop=%s wholeLine=%s seed=%u clock=%s\n"
+        "ticks=%llu framesWritten=%llu framesSkipped=%llu runTime=%s %s realTime=%.3fms\n"
+        "late=%llu maxLate=%lldus avgLate=%.1fus maxStale=%lldus resyncs=%llu lead=%lldus stopLatency=%lldus\n",
+        (int)s.mode, calibration::ToUtf8(calibration::ModeLabel(s.mode)).c_str(),
+        s.cols, s.rows, s.TotalCells(), s.intervalMs, s.OffDurationMs(),
+        s.loop ? "on" : "off", s.wholeLine ? "on" : "off", engine.Seed(),
+        opt.realTime ? "real" : "virtual",
+        (unsigned long long)st.ticks, (unsigned long long)st.framesWritten,
+        (unsigned long long)st.framesSkipped,
+        FormatDuration(clock.NowUs() - st.startUs).c_str(),
+        finished ? "(pass finished)" : "(budget reached)",
+        realUs / 1000.0,
+        (unsigned long long)st.lateTicks, (long long)st.maxLateUs,
+        st.ticks ? (double)st.totalLateUs / st.ticks : 0.0,
+        (long long)st.maxStaleUs, (unsigned long long)st.resyncs,
+        (long long)engine.EstimatedLeadUs(), (long long)st.stopLatencyUs);
+
+    const calibration::MemoryUsage mem = engine.Memory();
+    const std::size_t soakBytes = soakMonitor ? soakMonitor->MemoryBytes() : 0;
+    const double allocsPerTick = st.ticks ? (double)st.tickAllocations / st.ticks : 0.0;
+    if (calibration::AllocationCountingActive()) {
+        std::fprintf(stderr, "memory=%zuB (engine %zuB incl. rng %zuB, frame buffers %zuB, soak %zuB) "
+            "tickAllocs=%llu (%.3f/tick, %lluB)\n",
+            mem.TotalBytes() + soakBytes, mem.engineBytes, mem.rngBytes, mem.frameBufferBytes, soakBytes,
+            (unsigned long long)st.tickAllocations, allocsPerTick, (unsigned long long)st.tickAllocatedBytes);
+    }
+
+    if (frameWriter) {
+        const calibration::AsyncWriterStats ws = frameWriter->Stats();
+        std::fprintf(stderr, "frames out: %lluB in %llu batches (%llu buffers, max %d per batch) "
+            "stalls=%llu (%.3fms) writeErrors=%llu\n",
+            (unsigned long long)ws.bytesWritten, (unsigned long long)ws.batches,
+            (unsigned long long)ws.buffersWritten, ws.maxQueued,
+            (unsigned long long)ws.stalls, ws.stallUs / 1000.0, (unsigned long long)ws.writeErrors);
+    }
+
+    if (opt.json) {
+        std::printf("{\"mode\":%d,\"cols\":%d,\"rows\":%d,\"onMs\":%d,\"offMs\":%d,"
+            "\"loop\":%s,\"wholeLine\":%s,\"seed\":%u,\"clock\":\"%s\",\"finished\":%s,"
+            "\"ticks\":%llu,\"framesWritten\":%llu,\"framesSkipped\":%llu,"
+            "\"runTimeUs\":%lld,\"realTimeUs\":%lld,"
+            "\"lateTicks\":%llu,\"maxLateUs\":%lld,\"avgLateUs\":%.3f,\"maxStaleUs\":%lld,"
+            "\"resyncs\":%llu,\"leadUs\":%lld,\"stopLatencyUs\":%lld,"
+            "\"memory\":{\"totalBytes\":%zu,\"engineBytes\":%zu,\"rngBytes\":%zu,"
+            "\"frameBufferBytes\":%zu,\"soakBytes\":%zu},"
+            "\"allocations\":{\"counted\":%s,\"tick\":%llu,\"tickBytes\":%llu,\"perTick\":%.6f}}\n",
+            (int)s.mode, s.cols, s.rows, s.intervalMs, s.OffDurationMs(),
+            s.loop ? "true" : "false", s.wholeLine ? "true" : "false", engine.Seed(),
+            opt.realTime ? "real" : "virtual", finished ? "true" : "false",
+            (unsigned long long)st.ticks, (unsigned long long)st.framesWritten,
+            (unsigned long long)st.framesSkipped,
+            (long long)(clock.NowUs() - st.startUs), (long long)realUs,
+            (unsigned long long)st.lateTicks, (long long)st.maxLateUs,
+            st.ticks ? (double)st.totalLateUs / st.ticks : 0.0, (long long)st.maxStaleUs,
+            (unsigned long long)st.resyncs, (long long)engine.EstimatedLeadUs(), (long long)st.stopLatencyUs,
+            mem.TotalBytes() + soakBytes, mem.engineBytes, mem.rngBytes, mem.frameBufferBytes, soakBytes,
+            calibration::AllocationCountingActive() ? "true" : "false",
+            (unsigned long long)st.tickAllocations, (unsigned long long)st.tickAllocatedBytes, allocsPerTick);
+    }
+
+    if (opt.tracePath) {
+        calibration::EnableTrace(false);
+        if (!calibration::WriteChromeTrace(opt.tracePath)) {
+            std::fprintf(stderr, "cannot write trace to %s\n", opt.tracePath);
+        }
+    }
+
+    if (soakMonitor) {
+        std::fprintf(stderr, "soak: passes=%llu ticks=%llu windows=%d driftWindows=%d\n",
+            (unsigned long long)passes, (unsigned long long)(ticksBefore + st.ticks),
+            soakMonitor->WindowsClosed(), soakMonitor->DriftWindows());
+    }
+
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseArgs(argc, argv, opt)) {
+        PrintUsage();
+        return 2;
+    }
+
+    if (opt.command == Command::Conformance) return RunConformanceCommand(opt);
+    if (opt.command == Command::Explore) return RunExploreCommand(opt);
+    if (opt.command == Command::BenchSessions) return RunBenchSessionsCommand(opt);
+    if (opt.command == Command::BenchDiff) return RunBenchDiffCommand();
+    if (opt.command == Command::BenchE2E) return RunBenchE2ECommand(opt);
+    if (opt.command == Command::Fleet) return RunFleetCommand(opt);
+    if (opt.command == Command::Jitter) return RunJitterCommand(opt);
+    if (opt.command == Command::Faults) return RunFaultsCommand(opt);
+    if (opt.command == Command::Retest) return RunRetestCommand(opt);
+    if (opt.command == Command::ConformanceUpdate) {
+        calibration::PrintConformanceGolden(stdout);
+        return 0;
+    }
+
+    return RunCommand(opt);
+}
@@ -0,0 +1,278 @@
+#include "soak.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <system_error>
+
+namespace calibration {
+
+namespace {
+
+std::string FormatElapsed(std::int64_t us) {
+    const std::int64_t totalSec = us / 1000000;
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), "%lld:%02lld:%02lld",
+        (long long)(totalSec / 3600), (long long)((totalSec / 60) % 60), (long long)(totalSec % 60));
+    return buf;
+}
+
+} // namespace
+
+void LatencyHistogram::Add(std::int64_t us) {
+    if (us < 0) us = 0;
+
+    int bucket = 0;
+    for (std::uint64_t v = (std::uint64_t)us; v && bucket < kBuckets - 1; v >>= 1) bucket++;
+
+    buckets_[(size_t)bucket]++;
+    count_++;
+    sumUs_ += us;
+    maxUs_ = std::max(maxUs_, us);
+}
+
+std::int64_t LatencyHistogram::PercentileUs(double p) const {
+    if (!count_) return 0;
+
+    // Nearest rank: the smallest bucket holding at least p of the samples.
+    const std::uint64_t rank = std::max<std::uint64_t>(1, (std::uint64_t)std::ceil(p * (double)count_));
+    std::uint64_t seen = 0;
+    for (int b = 0; b < kBuckets; ++b) {
+        seen += buckets_[(size_t)b];
+        if (seen >= rank) {
+            const std::int64_t upper = b ? (1LL << b) - 1 : 0;
+            return std::min(upper, maxUs_);
+        }
+    }
+    return maxUs_;
+}
+
+RollingLog::RollingLog(std::string path, std::int64_t maxBytes, int files)
+    : path_(std::move(path)), maxBytes_(std::max<std::int64_t>(maxBytes, 1024)), files_(std::max(files, 1)) {
+    file_ = std::fopen(path_.c_str(), "ab");
+    if (file_) {
+        std::fseek(file_, 0, SEEK_END);
+        size_ = std::ftell(file_);
+    }
+}
+
+RollingLog::~RollingLog() {
+    if (file_) std::fclose(file_);
+}
+
+void RollingLog::Rotate() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+    // path.(n-2) -> path.(n-1), ..., path -> path.1; the oldest falls off.
+    std::error_code ec;
+    if (files_ > 1) {
+        for (int i = files_ - 1; i >= 1; --i) {
+            const std::string from = (i == 1) ? path_ : path_ + "." + std::to_string(i - 1);
+            std::filesystem::rename(from, path_ + "." + std::to_string(i), ec);
+        }
+    }
+
+    file_ = std::fopen(path_.c_str(), "wb");
+    size_ = 0;
+}
+
+void RollingLog::WriteLine(const std::string& line) {
+    if (size_ > 0 && size_ + (std::int64_t)line.size() + 1 > maxBytes_) Rotate();
+    if (!file_) return;
+
+    std::fwrite(line.data(), 1, line.size(), file_);
+    std::fputc('\n', file_);
+    std::fflush(file_);
+    size_ += (std::int64_t)line.size() + 1;
+}
+
+SoakReporter::SoakReporter(std::FILE* console, RollingLog* log)
+    : console_(console), log_(log), thread_([this] { Run(); }) {}
+
+SoakReporter::~SoakReporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void SoakReporter::Post(const SoakSummary& summary) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ == kQueueSize) {
+            head_ = (head_ + 1) % kQueueSize;
+            count_--;
+            dropped_++;
+        }
+        queue_[(size_t)((head_ + count_) % kQueueSize)] = summary;
+        count_++;
+    }
+    wake_.notify_one();
+}
+
+std::string SoakReporter::FormatLine(const SoakSummary& s) {
+    char buf[512];
+    std::snprintf(buf, sizeof(buf),
+        "soak %s window=%d t=%s ticks=%llu written=%llu skipped=%llu passes=%llu "
+        "late=%llu mean=%.1fus p50=%lldus p99=%lldus max=%lldus stale99=%lldus resyncs=%llu "
+        "baseline99=%lldus trend=%+.1fus/h drift=%s",
+        s.last ? "final" : (s.closed ? "closed" : "open"),
+        s.window, FormatElapsed(s.elapsedUs).c_str(),
+        (unsigned long long)s.ticks, (unsigned long long)s.framesWritten,
+        (unsigned long long)s.framesSkipped, (unsigned long long)s.passes,
+        (unsigned long long)s.lateTicks, s.meanLateUs,
+        (long long)s.p50LateUs, (long long)s.p99LateUs, (long long)s.maxLateUs,
+        (long long)s.p99StaleUs, (unsigned long long)s.resyncs,
+        (long long)s.baselineP99Us, s.trendUsPerHour, s.drift ? "YES" : "no");
+    return buf;
+}
+
+void SoakReporter::Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this] { return quit_ || count_ > 0; });
+
+        while (count_ > 0) {
+            const SoakSummary summary = queue_[(size_t)head_];
+            head_ = (head_ + 1) % kQueueSize;
+            count_--;
+            const std::uint64_t dropped = dropped_;
+            dropped_ = 0;
+            lock.unlock();
+
+            std::string line = FormatLine(summary);
+            if (dropped) line += " (" + std::to_string(dropped) + " earlier summaries dropped)";
+            if (console_) {
+                std::fprintf(console_, "%s\n", line.c_str());
+                std::fflush(console_);
+            }
+            if (log_) log_->WriteLine(line);
+
+            lock.lock();
+        }
+
+        if (quit_) break;
+    }
+}
+
+SoakMonitor::SoakMonitor(const SoakConfig& config, SoakReporter* reporter)
+    : config_(config), reporter_(reporter) {
+    config_.keepWindows = std::max(config_.keepWindows, 2);
+    history_.resize((size_t)config_.keepWindows);
+}
+
+void SoakMonitor::OnTick(const TickInfo& info) {
+    const std::int64_t now = info.deadlineUs + info.lateUs;
+    if (!started_) {
+        started_ = true;
+        startUs_ = now;
+        windowStartUs_ = now;
+        nextReportUs_ = now + config_.reportEveryUs;
+    }
+    lastUs_ = now;
+
+    if (now >= windowStartUs_ + config_.windowUs) {
+        CloseWindow(now);
+    }
+
+    late_.Add(info.lateUs);
+    stale_.Add(info.staleUs);
+    ticks_++;
+    if (info.written) written_++;
+    else skipped_++;
+    if (info.lateUs > 0) lateTicks_++;
+    if (info.resynced) resyncs_++;
+
+    if (now >= nextReportUs_) {
+        nextReportUs_ = now + config_.reportEveryUs;
+        if (reporter_) reporter_->Post(Summarize(now, false));
+    }
+}
+
+void SoakMonitor::Finish() {
+    if (!started_) return;
+    SoakSummary summary = Summarize(lastUs_, false);
+    summary.last = true;
+    if (reporter_) reporter_->Post(summary);
+}
+
+SoakSummary SoakMonitor::Summarize(std::int64_t nowUs, bool closed) const {
+    SoakSummary s;
+    s.window = windowIndex_;
+    s.closed = closed;
+    s.elapsedUs = nowUs - startUs_;
+
+    s.ticks = ticks_;
+    s.framesWritten = written_;
+    s.framesSkipped = skipped_;
+    s.lateTicks = lateTicks_;
+    s.resyncs = resyncs_;
+    s.passes = passes_;
+
+    s.meanLateUs = late_.MeanUs();
+    s.p50LateUs = late_.PercentileUs(0.50);
+    s.p99LateUs = late_.PercentileUs(0.99);
+    s.maxLateUs = late_.MaxUs();
+    s.p99StaleUs = stale_.PercentileUs(0.99);
+
+    s.baselineP99Us = baselineP99Us_;
+    s.trendUsPerHour = TrendUsPerHour();
+    s.drift = baselineP99Us_ >= 0 && ticks_ > 0 &&
+              s.p99LateUs > (std::int64_t)(config_.driftFactor * (double)baselineP99Us_) &&
+              s.p99LateUs > baselineP99Us_ + config_.driftMinUs;
+    return s;
+}
+
+void SoakMonitor::CloseWindow(std::int64_t nowUs) {
+    const SoakSummary summary = Summarize(nowUs, true);
+    if (summary.drift) driftWindows_++;
+    if (reporter_) reporter_->Post(summary);
+
+    if (ticks_ > 0) {
+        if (baselineP99Us_ < 0) baselineP99Us_ = summary.p99LateUs;
+
+        WindowRecord& rec = history_[(size_t)historyNext_];
+        rec.meanLateUs = summary.meanLateUs;
+        rec.p99LateUs = summary.p99LateUs;
+        historyNext_ = (historyNext_ + 1) % config_.keepWindows;
+        historyCount_ = std::min(historyCount_ + 1, config_.keepWindows);
+    }
+    windowIndex_++;
+
+    // Skip whole windows without ticks (a long pause) so boundaries stay aligned.
+    const std::int64_t elapsed = nowUs - windowStartUs_;
+    windowStartUs_ += (elapsed / config_.windowUs) * config_.windowUs;
+
+    late_.Reset();
+    stale_.Reset();
+    ticks_ = written_ = skipped_ = lateTicks_ = resyncs_ = 0;
+}
+
+double SoakMonitor::TrendUsPerHour() const {
+    const int n = historyCount_;
+    if (n < 2) return 0.0;
+
+    // Least-squares slope of window means, oldest first.
+    double sumX = 0, sumY = 0, sumXY = 0, sumXX = 0;
+    for (int i = 0; i < n; ++i) {
+        const int slot = (historyNext_ - n + i + config_.keepWindows) % config_.keepWindows;
+        const double x = i;
+        const double y = history_[(size_t)slot].meanLateUs;
+        sumX += x;
+        sumY += y;
+        sumXY += x * y;
+        sumXX += x * x;
+    }
+    const double denom = n * sumXX - sumX * sumX;
+    if (denom == 0) return 0.0;
+
+    const double perWindow = (n * sumXY - sumX * sumY) / denom;
+    return perWindow * (3600e6 / (double)config_.windowUs);
+}
+
+} // namespace calibration
@@ -0,0 +1,198 @@
+#pragma once
+
+// Soak (burn-in) monitoring for runs that last days, in constant memory.
+//
+// SoakMonitor observes every tick and keeps a latency histogram and counters
+// for the current window (an hour by default). Closed windows go into a fixed
+// ring (a day by default), which is also what drift detection looks at: each
+// window's p99 lateness is compared with the first window's, and the trend of
+// window means is reported in microseconds per hour.
+//
+// Summaries are handed to SoakReporter as fixed-size records; formatting and
+// all file/console I/O happen on the reporter's thread, so reporting does not
+// disturb tick timing. The log is a plain text file rotated at a size cap.
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+// Lateness histogram with power-of-two buckets: bucket 0 holds 0 us, bucket k
+// holds [2^(k-1), 2^k) us. Percentiles are reported as the bucket's upper bound.
+class LatencyHistogram {
+public:
+    static constexpr int kBuckets = 40;
+
+    void Add(std::int64_t us);
+    void Reset() { *this = LatencyHistogram{}; }
+
+    std::uint64_t Count() const { return count_; }
+    std::int64_t MaxUs() const { return maxUs_; }
+    double MeanUs() const { return count_ ? (double)sumUs_ / count_ : 0.0; }
+    std::int64_t PercentileUs(double p) const;
+    std::uint64_t BucketCount(int bucket) const { return buckets_[(size_t)bucket]; }
+
+private:
+    std::array<std::uint64_t, kBuckets> buckets_{};
+    std::uint64_t count_ = 0;
+    std::int64_t sumUs_ = 0;
+    std::int64_t maxUs_ = 0;
+};
+
+struct SoakConfig {
+    std::int64_t windowUs = 3600LL * 1000000;   // stats window (hourly)
+    std::int64_t reportEveryUs = 60LL * 1000000; // one-line summary of the open window
+    int keepWindows = 24;                        // closed windows kept for drift
+
+    // Drift: window p99 lateness above both factor x baseline and baseline + minUs.
+    double driftFactor = 2.0;
+    std::int64_t driftMinUs = 500;
+};
+
+struct SoakSummary {
+    int window = 0;                   // window number since the soak started
+    bool closed = false;              // false: periodic report of the open window
+    bool last = false;                // last report of the run
+    std::int64_t elapsedUs = 0;       // since the soak started
+
+    std::uint64_t ticks = 0;
+    std::uint64_t framesWritten = 0;
+    std::uint64_t framesSkipped = 0;
+    std::uint64_t lateTicks = 0;
+    std::uint64_t resyncs = 0;
+    std::uint64_t passes = 0;         // completed passes since the soak started
+
+    double meanLateUs = 0.0;
+    std::int64_t p50LateUs = 0;
+    std::int64_t p99LateUs = 0;
+    std::int64_t maxLateUs = 0;
+    std::int64_t p99StaleUs = 0;
+
+    bool drift = false;
+    std::int64_t baselineP99Us = -1;  // -1 until the first window closes
+    double trendUsPerHour = 0.0;      // slope of window mean lateness
+};
+
+// Text log that rotates to path.1 .. path.(files-1) when it would exceed maxBytes.
+class RollingLog {
+public:
+    RollingLog(std::string path, std::int64_t maxBytes, int files);
+    ~RollingLog();
+
+    RollingLog(const RollingLog&) = delete;
+    RollingLog& operator=(const RollingLog&) = delete;
+
+    void WriteLine(const std::string& line);
+
+private:
+    void Rotate();
+
+    std::string path_;
+    std::int64_t maxBytes_;
+    int files_;
+    std::FILE* file_ = nullptr;
+    std::int64_t size_ = 0;
+};
+
+class SoakReporter {
+public:
+    // Either output may be null.
+    SoakReporter(std::FILE* console, RollingLog* log);
+    ~SoakReporter(); // writes everything still queued
+
+    SoakReporter(const SoakReporter&) = delete;
+    SoakReporter& operator=(const SoakReporter&) = delete;
+
+    // Called on the ticking thread; never blocks on I/O. If the writer falls
+    // behind, the oldest queued summaries are dropped (and counted).
+    void Post(const SoakSummary& summary);
+
+    static std::string FormatLine(const SoakSummary& summary);
+
+private:
+    static constexpr int kQueueSize = 16;
+
+    void Run();
+
+    std::FILE* console_;
+    RollingLog* log_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::array<SoakSummary, kQueueSize> queue_;
+    int head_ = 0;
+    int count_ = 0;
+    std::uint64_t dropped_ = 0;
+    bool quit_ = false;
+
+    std::thread thread_;
+};
+
+class SoakMonitor : public TickObserver {
+public:
+    SoakMonitor(const SoakConfig& config, SoakReporter* reporter);
+
+    void OnTick(const TickInfo& info) override;
+
+    // A pass with loop off finished and the soak starts the next one.
+    void OnPassFinished() { passes_++; }
+
+    // Posts the final summary of the open window.
+    void Finish();
+
+    bool DriftDetected() const { return driftWindows_ > 0; }
+    int DriftWindows() const { return driftWindows_; }
+    int WindowsClosed() const { return windowIndex_; }
+
+    // Fixed after construction: the object plus the closed-window ring.
+    std::size_t MemoryBytes() const { return sizeof(*this) + history_.capacity() * sizeof(WindowRecord); }
+
+private:
+    struct WindowRecord {
+        double meanLateUs = 0.0;
+        std::int64_t p99LateUs = 0;
+    };
+
+    SoakSummary Summarize(std::int64_t nowUs, bool closed) const;
+    void CloseWindow(std::int64_t nowUs);
+    double TrendUsPerHour() const;
+
+    SoakConfig config_;
+    SoakReporter* reporter_;
+
+    bool started_ = false;
+    std::int64_t startUs_ = 0;
+    std::int64_t windowStartUs_ = 0;
+    std::int64_t nextReportUs_ = 0;
+    std::int64_t lastUs_ = 0;
+
+    // Current window
+    LatencyHistogram late_;
+    LatencyHistogram stale_;
+    std::uint64_t ticks_ = 0;
+    std::uint64_t written_ = 0;
+    std::uint64_t skipped_ = 0;
+    std::uint64_t lateTicks_ = 0;
+    std::uint64_t resyncs_ = 0;
+
+    std::uint64_t passes_ = 0;
+
+    // Closed windows, fixed ring (allocated once).
+    std::vector<WindowRecord> history_;
+    int historyNext_ = 0;
+    int historyCount_ = 0;
+    int windowIndex_ = 0;
+
+    std::int64_t baselineP99Us_ = -1;
+    int driftWindows_ = 0;
+};
+
+} // namespace calibration
@@ -0,0 +1,106 @@
+#include "terminal_view.h"
+
+#include <algorithm>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+namespace {
+
+void AppendInt(int v, std::string& out) {
+    char digits[12];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0 && n < (int)sizeof(digits));
+    while (n > 0) out += digits[--n];
+}
+
+} // namespace
+
+void AppendCursorTo(int row, int col, std::string& out) {
+    out += "\x1b[";
+    AppendInt(row, out);
+    out += ';';
+    AppendInt(col, out);
+    out += 'H';
+}
+
+void AppendUtf8Cell(wchar_t cell, std::string& out) {
+    const std::uint32_t c = (std::uint32_t)cell;
+    if (c < 0x80) {
+        out += (char)c;
+    } else if (c < 0x800) {
+        out += (char)(0xC0 | (c >> 6));
+        out += (char)(0x80 | (c & 0x3F));
+    } else {
+        out += (char)(0xE0 | (c >> 12));
+        out += (char)(0x80 | ((c >> 6) & 0x3F));
+        out += (char)(0x80 | (c & 0x3F));
+    }
+}
+
+void AppendUtf8(const std::wstring& line, std::string& out) {
+    for (wchar_t c : line) AppendUtf8Cell(c, out);
+}
+
+std::string ToUtf8(const std::wstring& line) {
+    std::string out;
+    out.reserve(line.size() * 3);
+    AppendUtf8(line, out);
+    return out;
+}
+
+void TerminalView::Reset(int cols, int rows, int top, int left) {
+    cols_ = cols > 0 ? cols : 1;
+    rows_ = rows > 0 ? rows : 1;
+    top_ = top;
+    left_ = left;
+    shown_.assign((size_t)cols_ * rows_, kBrailleBlank);
+    valid_ = false;
+}
+
+int TerminalView::Render(const std::wstring& line, std::string& out) {
+    const size_t before = out.size();
+    const int cells = cols_ * rows_;
+
+    const wchar_t* next = line.data();
+    if ((int)line.size() != cells) {
+        padded_.assign(line, 0, std::min(line.size(), (size_t)cells));
+        padded_.resize((size_t)cells, kBrailleBlank);
+        next = padded_.data();
+    }
+
+    if (valid_) {
+        DiffFrames(shown_.data(), next, cells, mergeGap_, spans_);
+    } else {
+        spans_.assign(1, CellSpan{ 0, cells });
+        valid_ = true;
+    }
+
+    int written = 0;
+    for (const CellSpan& span : spans_) {
+        int i = span.begin;
+        while (i < span.end) {
+            // Cut at the end of the grid row.
+            const int row = i / cols_;
+            const int end = std::min(span.end, (row + 1) * cols_);
+            AppendCursorTo(top_ + row, left_ + i % cols_, out);
+            stats_.spans++;
+            for (; i < end; ++i) {
+                AppendUtf8Cell(next[i], out);
+                shown_[(size_t)i] = next[i];
+            }
+        }
+        written += span.end - span.begin;
+    }
+
+    stats_.frames++;
+    stats_.cellsWritten += (std::uint64_t)written;
+    stats_.bytes += out.size() - before;
+    return written;
+}
+
+} // namespace calibration
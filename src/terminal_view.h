@@ -0,0 +1,75 @@
+#pragma once
+
+// Renders the braille line as a cols x rows grid on a VT100-style terminal,
+// rewriting only the cells that changed since the last frame.
+//
+// The view keeps a copy of what the terminal shows and diffs each frame
+// against it (DiffFrames). Every dirty span becomes one cursor move
+// (CSI row;col H) followed by its cells in UTF-8, split where it crosses a
+// grid row. Changed runs up to MergeGap() unchanged cells apart are sent as
+// one span: a cursor move is about as long as two or three cells. A walking
+// frame changes one or two cells, so a frame is a few dozen bytes however
+// large the grid is. Output is appended to a caller-owned string, so
+// the caller can issue one write per frame and no allocation happens once the
+// string has grown. Platform-independent; the terminal setup lives in the
+// frontend (tui_main.cpp).
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frame_diff.h"
+
+namespace calibration {
+
+struct TerminalViewStats {
+    std::uint64_t frames = 0;
+    std::uint64_t spans = 0;          // cursor-addressed runs written
+    std::uint64_t cellsWritten = 0;
+    std::uint64_t bytes = 0;
+};
+
+class TerminalView {
+public:
+    // Grid geometry and the screen position (1-based) of cell 0. Forgets what
+    // is shown, so the next Render writes every cell.
+    void Reset(int cols, int rows, int top, int left);
+
+    // Appends the escape sequences that bring the grid on screen to `line`
+    // (cols * rows cells; missing cells render blank). Returns the number of
+    // cells written, 0 if nothing changed.
+    int Render(const std::wstring& line, std::string& out);
+
+    // Unchanged cells rewritten rather than skipped with a cursor move.
+    void SetMergeGap(int cells) { mergeGap_ = cells < 0 ? 0 : cells; }
+    int MergeGap() const { return mergeGap_; }
+
+    // Cursor position just below the grid, for status output after a frame.
+    int BottomRow() const { return top_ + rows_; }
+
+    const TerminalViewStats& Stats() const { return stats_; }
+
+private:
+    int cols_ = 0;
+    int rows_ = 0;
+    int top_ = 1;
+    int left_ = 1;
+    int mergeGap_ = 2;
+    std::wstring shown_;
+    bool valid_ = false;              // shown_ matches the screen
+    std::wstring padded_;             // a line of the wrong length, fitted to the grid
+    std::vector<CellSpan> spans_;
+    TerminalViewStats stats_;
+};
+
+// Appends CSI row;col H.
+void AppendCursorTo(int row, int col, std::string& out);
+
+// Appends one cell (BMP code point) as UTF-8.
+void AppendUtf8Cell(wchar_t cell, std::string& out);
+
+// The same for a whole line (braille frames, mode labels).
+void AppendUtf8(const std::wstring& line, std::string& out);
+std::string ToUtf8(const std::wstring& line);
+
+} // namespace calibration
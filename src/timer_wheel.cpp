@@ -0,0 +1,195 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace calibration {
+
+namespace {
+
+constexpr std::int64_t kSlotMask = TimerWheel::kSlots - 1;
+
+int LowestBit(std::uint64_t word) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return (int)index;
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+// First set bit at or after `from` in a 256-bit slot bitmap, -1 if none.
+int NextOccupied(const std::array<std::uint64_t, TimerWheel::kSlots / 64>& bits, int from) {
+    if (from >= TimerWheel::kSlots) return -1;
+    int word = from / 64;
+    std::uint64_t w = bits[(size_t)word] & (~0ULL << (from % 64));
+    for (;;) {
+        if (w) return word * 64 + LowestBit(w);
+        if (++word == TimerWheel::kSlots / 64) return -1;
+        w = bits[(size_t)word];
+    }
+}
+
+int Digit(std::int64_t tick, int level) {
+    return (int)((tick >> (level * TimerWheel::kSlotBits)) & kSlotMask);
+}
+
+} // namespace
+
+TimerWheel::TimerWheel(std::int64_t startUs, std::int64_t resolutionUs)
+    : startUs_(startUs), resolutionUs_(std::max<std::int64_t>(resolutionUs, 1)) {
+    heads_.fill(kNone);
+}
+
+void TimerWheel::Reserve(int ids) {
+    if ((size_t)ids > nodes_.size()) nodes_.resize((size_t)ids);
+}
+
+void TimerWheel::Schedule(int id, std::int64_t deadlineUs) {
+    if ((size_t)id >= nodes_.size()) nodes_.resize((size_t)id + 1);
+    Node& node = nodes_[(size_t)id];
+    if (node.list != kNone) {
+        Unlink(id);
+        armed_--;
+    }
+
+    // Round up to a slot boundary so the timer never fires early.
+    const std::int64_t sinceStart = deadlineUs - startUs_;
+    const std::int64_t expiry = sinceStart > 0 ? (sinceStart + resolutionUs_ - 1) / resolutionUs_ : 0;
+    node.expiry = std::max(expiry, tick_);
+    Link(id);
+    armed_++;
+}
+
+void TimerWheel::Cancel(int id) {
+    if (!Scheduled(id)) return;
+    Unlink(id);
+    armed_--;
+}
+
+bool TimerWheel::Scheduled(int id) const {
+    return (size_t)id < nodes_.size() && nodes_[(size_t)id].list != kNone;
+}
+
+void TimerWheel::Link(std::int32_t id) {
+    Node& node = nodes_[(size_t)id];
+
+    // Lowest level whose current turn contains the expiry: above that level
+    // the expiry and the wheel position agree.
+    int list = kOverflow;
+    for (int level = 0; level < kLevels; ++level) {
+        const int above = (level + 1) * kSlotBits;
+        if ((node.expiry >> above) == (tick_ >> above)) {
+            const int slot = Digit(node.expiry, level);
+            list = level * kSlots + slot;
+            occupied_[(size_t)level][(size_t)slot / 64] |= 1ULL << (slot % 64);
+            break;
+        }
+    }
+
+    node.list = list;
+    node.prev = kNone;
+    node.next = heads_[(size_t)list];
+    if (node.next != kNone) nodes_[(size_t)node.next].prev = id;
+    heads_[(size_t)list] = id;
+}
+
+void TimerWheel::Unlink(std::int32_t id) {
+    Node& node = nodes_[(size_t)id];
+    if (node.prev != kNone) nodes_[(size_t)node.prev].next = node.next;
+    else heads_[(size_t)node.list] = node.next;
+    if (node.next != kNone) nodes_[(size_t)node.next].prev = node.prev;
+
+    if (heads_[(size_t)node.list] == kNone && node.list != kOverflow) {
+        const int level = node.list / kSlots;
+        const int slot = node.list % kSlots;
+        occupied_[(size_t)level][(size_t)slot / 64] &= ~(1ULL << (slot % 64));
+    }
+    node.list = kNone;
+}
+
+// Re-links the list the wheel just reached at `level` (kLevels: overflow);
+// every timer lands on a lower level.
+void TimerWheel::Cascade(int level) {
+    const int list = level == kLevels ? kOverflow : level * kSlots + Digit(tick_, level);
+    std::int32_t id = heads_[(size_t)list];
+    heads_[(size_t)list] = kNone;
+    if (level < kLevels) {
+        const int slot = list % kSlots;
+        occupied_[(size_t)level][(size_t)slot / 64] &= ~(1ULL << (slot % 64));
+    }
+
+    while (id != kNone) {
+        const std::int32_t next = nodes_[(size_t)id].next;
+        Link(id);
+        id = next;
+    }
+}
+
+int TimerWheel::Expire(std::int64_t nowUs, std::vector<int>& due) {
+    if (nowUs < startUs_) return 0;
+    const std::int64_t target = (nowUs - startUs_) / resolutionUs_;
+    const size_t before = due.size();
+
+    while (tick_ <= target) {
+        const std::int64_t turnStart = tick_ & ~kSlotMask;
+        const int slot = NextOccupied(occupied_[0], (int)(tick_ & kSlotMask));
+
+        if (slot >= 0 && turnStart + slot <= target) {
+            // The whole slot is due: unlink it as one list.
+            std::int32_t id = heads_[(size_t)slot];
+            heads_[(size_t)slot] = kNone;
+            occupied_[0][(size_t)slot / 64] &= ~(1ULL << (slot % 64));
+            while (id != kNone) {
+                Node& node = nodes_[(size_t)id];
+                node.list = kNone;
+                due.push_back(id);
+                armed_--;
+                id = node.next;
+            }
+            tick_ = turnStart + slot + 1;
+        } else {
+            // Nothing due before the next cascade that has work: skip to it.
+            const std::int64_t next = NextEventTick();
+            tick_ = (next < 0 || next > target) ? target + 1 : next;
+        }
+
+        // Reaching the start of a level-0 turn: pull the next slot of each
+        // level whose turn also starts here down, highest first.
+        if ((tick_ & kSlotMask) == 0) {
+            int top = 1;
+            while (top < kLevels && Digit(tick_, top) == 0) top++;
+            if (top == kLevels && (tick_ >> (kLevels * kSlotBits)) != 0) Cascade(kLevels);
+            for (int level = std::min(top, kLevels - 1); level >= 1; --level) Cascade(level);
+        }
+    }
+    return (int)(due.size() - before);
+}
+
+std::int64_t TimerWheel::NextEventTick() const {
+    if (armed_ == 0) return -1;
+
+    const int slot = NextOccupied(occupied_[0], (int)(tick_ & kSlotMask));
+    if (slot >= 0) return (tick_ & ~kSlotMask) + slot;
+
+    for (int level = 1; level < kLevels; ++level) {
+        const int next = NextOccupied(occupied_[(size_t)level], Digit(tick_, level) + 1);
+        if (next < 0) continue;
+        const int above = (level + 1) * kSlotBits;
+        return ((tick_ >> above) << above) + ((std::int64_t)next << (level * kSlotBits));
+    }
+
+    const int all = kLevels * kSlotBits;
+    return ((tick_ >> all) + 1) << all;
+}
+
+std::int64_t TimerWheel::NextExpiryUs() const {
+    const std::int64_t tick = NextEventTick();
+    return tick < 0 ? -1 : TickStartUs(tick);
+}
+
+} // namespace calibration
@@ -0,0 +1,83 @@
+#pragma once
+
+// Hierarchical timing wheel for driving many sessions from one thread.
+//
+// One OS timer per session does not scale, and a binary heap costs O(log n)
+// per tick per session. The wheel keeps four levels of 256 slots: level 0
+// slots are one resolution wide, each higher level's slots span a whole turn
+// of the level below. A timer is linked into the slot of the lowest level
+// whose turn contains its deadline; when a lower level finishes a turn, the
+// next slot of the level above is redistributed downwards. Scheduling,
+// cancelling and expiring are O(1) per timer; timers due in the same slot are
+// unlinked as one list.
+//
+// Timers never fire early: a deadline is rounded up to the next slot
+// boundary, so a timer fires up to one resolution after its deadline (plus
+// however late the caller calls Expire). Deadlines more than 256^4
+// resolutions ahead wait on an overflow list. Timer ids are small dense
+// integers (session indices). Not thread-safe.
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace calibration {
+
+class TimerWheel {
+public:
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 8;
+    static constexpr int kSlots = 1 << kSlotBits;
+
+    explicit TimerWheel(std::int64_t startUs = 0, std::int64_t resolutionUs = 1000);
+
+    // Pre-sizes the timer table for ids 0..ids-1.
+    void Reserve(int ids);
+
+    // Arms timer id for deadlineUs, replacing a pending deadline. A deadline
+    // that is already past fires on the next Expire.
+    void Schedule(int id, std::int64_t deadlineUs);
+    void Cancel(int id);
+    bool Scheduled(int id) const;
+
+    // Advances the wheel to nowUs and appends the ids of every timer due by
+    // then to `due`, slot by slot in deadline order. Returns how many were
+    // appended. Due timers are disarmed before this returns.
+    int Expire(std::int64_t nowUs, std::vector<int>& due);
+
+    // No timer fires before this time (-1 when none is armed). Exact when the
+    // earliest timer is within the current level-0 turn; otherwise the start
+    // of the slot it waits in, where the wheel redistributes it.
+    std::int64_t NextExpiryUs() const;
+
+    int Size() const { return armed_; }
+    std::int64_t ResolutionUs() const { return resolutionUs_; }
+
+private:
+    static constexpr int kOverflow = kLevels * kSlots; // list index of the overflow list
+    static constexpr std::int32_t kNone = -1;
+
+    struct Node {
+        std::int32_t next = kNone;
+        std::int32_t prev = kNone;
+        std::int32_t list = kNone;   // slot list it is linked into, kNone when disarmed
+        std::int64_t expiry = 0;     // in ticks
+    };
+
+    void Link(std::int32_t id);
+    void Unlink(std::int32_t id);
+    void Cascade(int level);
+    std::int64_t NextEventTick() const;  // level-0 slot or cascade point, -1 if empty
+    std::int64_t TickStartUs(std::int64_t tick) const { return startUs_ + tick * resolutionUs_; }
+
+    const std::int64_t startUs_;
+    const std::int64_t resolutionUs_;
+    std::int64_t tick_ = 0;          // next level-0 slot to expire
+    int armed_ = 0;
+
+    std::vector<Node> nodes_;
+    std::array<std::int32_t, kLevels * kSlots + 1> heads_;
+    std::array<std::array<std::uint64_t, kSlots / 64>, kLevels> occupied_{}; // non-empty slots
+};
+
+} // namespace calibration
@@ -0,0 +1,136 @@
+#include "trace.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+namespace trace_detail {
+
+std::atomic<bool> enabled{ false };
+
+} // namespace trace_detail
+
+namespace {
+
+constexpr std::uint64_t kEventsPerThread = 1u << 16; // power of two
+
+struct TraceEvent {
+    const char* name;
+    std::int64_t startUs;
+    std::int64_t durUs;
+};
+
+// Single writer (the owning thread); the exporter reads up to `written`.
+struct ThreadBuffer {
+    int tid = 0;
+    std::atomic<const char*> threadName{ nullptr };
+    std::atomic<std::uint64_t> written{ 0 };
+    std::unique_ptr<TraceEvent[]> events{ new TraceEvent[kEventsPerThread] };
+};
+
+// Buffers live until exit, so a thread may finish before the export.
+std::mutex g_buffersMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+
+ThreadBuffer* CurrentBuffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::unique_ptr<ThreadBuffer> fresh(new ThreadBuffer);
+        std::lock_guard<std::mutex> lock(g_buffersMutex);
+        fresh->tid = (int)g_buffers.size() + 1;
+        buffer = fresh.get();
+        g_buffers.push_back(std::move(fresh));
+    }
+    return buffer;
+}
+
+const SteadyClock g_clock{};
+const std::int64_t g_epochUs = g_clock.NowUs();
+
+void AppendEscaped(std::string& out, const char* s) {
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') out += '\\';
+        out += *s;
+    }
+}
+
+} // namespace
+
+namespace trace_detail {
+
+std::int64_t NowUs() {
+    return g_clock.NowUs() - g_epochUs;
+}
+
+void Record(const char* name, std::int64_t startUs, std::int64_t durUs) {
+    ThreadBuffer* buffer = CurrentBuffer();
+    const std::uint64_t n = buffer->written.load(std::memory_order_relaxed);
+    buffer->events[n & (kEventsPerThread - 1)] = TraceEvent{ name, startUs, durUs };
+    buffer->written.store(n + 1, std::memory_order_release);
+}
+
+} // namespace trace_detail
+
+void EnableTrace(bool on) {
+    trace_detail::enabled.store(on, std::memory_order_relaxed);
+}
+
+void SetTraceThreadName(const char* name) {
+    CurrentBuffer()->threadName.store(name, std::memory_order_relaxed);
+}
+
+bool WriteChromeTrace(const std::filesystem::path& path) {
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    char buf[96];
+
+    std::lock_guard<std::mutex> lock(g_buffersMutex);
+    for (const std::unique_ptr<ThreadBuffer>& b : g_buffers) {
+        const char* threadName = b->threadName.load(std::memory_order_relaxed);
+        if (threadName) {
+            if (!first) out += ",\n";
+            first = false;
+            std::snprintf(buf, sizeof(buf), "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", b->tid);
+            out += buf;
+            AppendEscaped(out, threadName);
+            out += "\"}}";
+        }
+
+        const std::uint64_t written = b->written.load(std::memory_order_acquire);
+        const std::uint64_t begin = written > kEventsPerThread ? written - kEventsPerThread : 0;
+        for (std::uint64_t i = begin; i < written; ++i) {
+            const TraceEvent& e = b->events[i & (kEventsPerThread - 1)];
+            if (!first) out += ",\n";
+            first = false;
+
+            out += "{\"name\":\"";
+            AppendEscaped(out, e.name);
+            if (e.durUs < 0) {
+                std::snprintf(buf, sizeof(buf), "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld,\"pid\":1,\"tid\":%d}",
+                    (long long)e.startUs, b->tid);
+            } else {
+                std::snprintf(buf, sizeof(buf), "\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d}",
+                    (long long)e.startUs, (long long)e.durUs, b->tid);
+            }
+            out += buf;
+        }
+    }
+    out += "\n]}\n";
+
+#ifdef _WIN32
+    std::FILE* f = _wfopen(path.c_str(), L"wb");
+#else
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+#endif
+    if (!f) return false;
+    const bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    return (std::fclose(f) == 0) && ok;
+}
+
+} // namespace calibration
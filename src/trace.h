@@ -0,0 +1,60 @@
+#pragma once
+
+// Optional span tracing of the tick pipeline (scheduler wait, frame build,
+// display write, accessibility notification), exported as Chrome trace JSON
+// for chrome://tracing or ui.perfetto.dev.
+//
+// Each thread records into its own fixed-size ring (the newest events win), so
+// recording takes no lock. When tracing is off a span costs one relaxed load.
+// Export is meant for after the run; events recorded during an export may be
+// missing or torn.
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+
+namespace calibration {
+
+namespace trace_detail {
+
+extern std::atomic<bool> enabled;
+
+std::int64_t NowUs();
+void Record(const char* name, std::int64_t startUs, std::int64_t durUs); // durUs < 0: instant
+
+} // namespace trace_detail
+
+inline bool TraceEnabled() { return trace_detail::enabled.load(std::memory_order_relaxed); }
+
+void EnableTrace(bool on);
+
+// Names the calling thread in the exported trace. name must be a literal.
+void SetTraceThreadName(const char* name);
+
+// Point event (for example a scheduler wake-up). name must be a literal.
+inline void TraceInstant(const char* name) {
+    if (TraceEnabled()) trace_detail::Record(name, trace_detail::NowUs(), -1);
+}
+
+// Writes every thread's buffered events; returns false on I/O errors.
+bool WriteChromeTrace(const std::filesystem::path& path);
+
+// Records [construction, destruction) as a complete event. name must be a literal.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name)
+        : name_(TraceEnabled() ? name : nullptr), startUs_(name_ ? trace_detail::NowUs() : 0) {}
+
+    ~TraceSpan() {
+        if (name_) trace_detail::Record(name_, startUs_, trace_detail::NowUs() - startUs_);
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    std::int64_t startUs_;
+};
+
+} // namespace calibration
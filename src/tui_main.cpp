@@ -0,0 +1,338 @@
+// Terminal frontend for POSIX stations without the Win32 dialog.
+//
+// Shows the live braille line wrapped to the cols x rows grid, with a status
+// line and the dialog's key controls. The engine runs on its own thread under
+// the real-time runner; this thread only reads keys and forwards them as
+// runner commands. Frames are rendered by TerminalView (changed cells only)
+// and go out as one write() per frame from the runner thread.
+//
+// Keys: S or Esc stop, P or Enter pause/resume, M marks the cell on display
+// (listed on exit), Left/Right seek one step, Up/Down to the cell above or below,
+// Home back to the first step.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "calibration_engine.h"
+#include "scheduler.h"
+#include "terminal_view.h"
+
+namespace {
+
+using calibration::Mode;
+
+constexpr int kGridTop = 4;                      // rows 1-2 header, 3 blank
+constexpr std::int64_t kStatusEveryUs = 200000;  // status refresh while frames flow
+
+volatile std::sig_atomic_t g_signalled = 0;
+
+void OnSignal(int) { g_signalled = 1; }
+
+struct Options {
+    calibration::Settings settings;
+    std::uint32_t seed = 1;
+};
+
+void WriteAll(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        const ssize_t n = ::write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+}
+
+// Raw keys (no echo, no line buffering) on the alternate screen, cursor
+// hidden. Ctrl-C still raises SIGINT. Restored on destruction.
+class RawTerminal {
+public:
+    RawTerminal() {
+        if (tcgetattr(STDIN_FILENO, &saved_) == 0) {
+            termios raw = saved_;
+            raw.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+            raw.c_iflag &= ~(tcflag_t)(ICRNL | IXON);
+            raw.c_cc[VMIN] = 0;
+            raw.c_cc[VTIME] = 0;
+            active_ = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+        }
+        const char enter[] = "\x1b[?1049h\x1b[?25l\x1b[2J";
+        WriteAll(STDOUT_FILENO, enter, sizeof(enter) - 1);
+    }
+
+    ~RawTerminal() {
+        const char leave[] = "\x1b[?25h\x1b[?1049l";
+        WriteAll(STDOUT_FILENO, leave, sizeof(leave) - 1);
+        if (active_) tcsetattr(STDIN_FILENO, TCSANOW, &saved_);
+    }
+
+    RawTerminal(const RawTerminal&) = delete;
+    RawTerminal& operator=(const RawTerminal&) = delete;
+
+private:
+    termios saved_{};
+    bool active_ = false;
+};
+
+struct Mark {
+    int cell = -1;
+    std::int64_t atUs = 0;  // since the first frame
+};
+
+// Renders frames on the runner thread; status redraws and marks come from the
+// key thread, hence the mutex (uncontended while no key is pressed).
+class TerminalSink : public calibration::FrameSink {
+public:
+    explicit TerminalSink(const calibration::Settings& s) : cols_(s.cols) {
+        view_.Reset(s.cols, s.rows, kGridTop, 1);
+        out_.reserve((size_t)s.TotalCells() * 3 + 256);
+    }
+
+    void WriteFrame(const std::wstring& line, std::int64_t timeUs) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (startUs_ < 0) startUs_ = timeUs;
+        lastUs_ = timeUs;
+
+        const auto lit = std::find_if(line.begin(), line.end(),
+            [](wchar_t c) { return c != calibration::kBrailleBlank; });
+        if (lit != line.end()) litCell_ = (int)(lit - line.begin());
+
+        out_.clear();
+        view_.Render(line, out_);
+        if (timeUs - statusUs_ >= kStatusEveryUs) AppendStatus();
+        WriteAll(STDOUT_FILENO, out_.data(), out_.size());
+    }
+
+    void SetState(const char* state) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        state_ = state;
+        Redraw();
+    }
+
+    void AddMark() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (litCell_ >= 0) marks_.push_back({ litCell_, lastUs_ - startUs_ });
+        Redraw();
+    }
+
+    std::vector<Mark> Marks() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return marks_;
+    }
+
+    calibration::TerminalViewStats ViewStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return view_.Stats();
+    }
+
+private:
+    void Redraw() {
+        out_.clear();
+        AppendStatus();
+        WriteAll(STDOUT_FILENO, out_.data(), out_.size());
+    }
+
+    void AppendStatus() {
+        statusUs_ = lastUs_;
+        char text[160];
+        int n;
+        if (litCell_ >= 0) {
+            n = std::snprintf(text, sizeof(text), "%-8s cell %d (row %d, col %d)  %.1fs  frames %llu  marks %zu",
+                state_, litCell_ + 1, litCell_ / cols_ + 1, litCell_ % cols_ + 1,
+                startUs_ >= 0 ? (lastUs_ - startUs_) / 1e6 : 0.0,
+                (unsigned long long)view_.Stats().frames, marks_.size());
+        } else {
+            n = std::snprintf(text, sizeof(text), "%-8s  marks %zu", state_, marks_.size());
+        }
+        calibration::AppendCursorTo(view_.BottomRow() + 1, 1, out_);
+        out_ += "\x1b[2K";
+        out_.append(text, (size_t)std::max(0, std::min(n, (int)sizeof(text) - 1)));
+    }
+
+    const int cols_;
+    mutable std::mutex mutex_;
+    calibration::TerminalView view_;
+    std::string out_;
+    const char* state_ = "Running";
+    std::int64_t startUs_ = -1;
+    std::int64_t lastUs_ = 0;
+    std::int64_t statusUs_ = std::numeric_limits<std::int64_t>::min() / 2;
+    int litCell_ = -1;
+    std::vector<Mark> marks_;
+};
+
+void PrintUsage() {
+    std::printf(
+        "Usage: BrailleCalibrationTui [options]\n"
+        "  --cols N          columns (default 24)\n"
+        "  --rows N          rows (default 4)\n"
+        "  --interval MS     tick interval / ON time in ms (default 500)\n"
+        "  --off MS          OFF (blank) time in ms, 0 = no OFF phase (default = interval)\n"
+        "  --mode N          mode index 0..%d, same order as the dialog combo\n"
+        "  --whole-line      blink the whole line instead of walking\n"
+        "  --no-loop         stop after one pass\n"
+        "  --seed N          RNG seed for random modes (default 1)\n"
+        "\n"
+        "Keys: S/Esc stop, P/Enter pause, M mark the cell on display,\n"
+        "      Left/Right seek one step, Up/Down one row, Home first step\n",
+        calibration::kModeCount - 1);
+}
+
+bool ParseArgs(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const bool hasValue = (i + 1 < argc);
+
+        if (!std::strcmp(a, "--cols") && hasValue) opt.settings.cols = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--rows") && hasValue) opt.settings.rows = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--interval") && hasValue) opt.settings.intervalMs = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--off") && hasValue) opt.settings.offMs = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--mode") && hasValue) opt.settings.mode = (Mode)std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--whole-line")) opt.settings.wholeLine = true;
+        else if (!std::strcmp(a, "--no-loop")) opt.settings.loop = false;
+        else if (!std::strcmp(a, "--seed") && hasValue) opt.seed = (std::uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        else return false;
+    }
+
+    const calibration::Settings& s = opt.settings;
+    if (s.cols <= 0 || s.rows <= 0 || s.intervalMs <= 0) return false;
+    if (1LL * s.cols * s.rows > 5000) return false;
+    if ((int)s.mode < 0 || (int)s.mode >= calibration::kModeCount) return false;
+    return true;
+}
+
+// Maps the bytes of one read() to runner commands. Arrow keys arrive as
+// ESC [ x (or ESC O x); an ESC on its own is the stop key.
+void HandleKeys(const char* keys, int n, const calibration::Settings& s,
+                calibration::RunnerCommands& commands, const calibration::SteadyClock& clock,
+                TerminalSink& sink) {
+    for (int i = 0; i < n; ++i) {
+        const char c = keys[i];
+        if (c == '\x1b' && i + 2 < n && (keys[i + 1] == '[' || keys[i + 1] == 'O')) {
+            switch (keys[i + 2]) {
+            case 'C': commands.RequestSeek(1); break;
+            case 'D': commands.RequestSeek(-1); break;
+            case 'B': commands.RequestSeekRows(1); break;
+            case 'A': commands.RequestSeekRows(-1); break;
+            case 'H': commands.RequestSeek(-s.TotalCells()); break;
+            default: break;
+            }
+            i += 2;
+            while (i + 1 < n && keys[i] >= '0' && keys[i] <= '9') ++i; // ESC [ 1 ~ and friends
+            continue;
+        }
+
+        if (c == '\x1b' || c == 's' || c == 'S') {
+            commands.RequestStop(clock);
+            return;
+        }
+        if (c == 'p' || c == 'P' || c == '\r' || c == '\n') {
+            const bool pause = !commands.pause.load(std::memory_order_relaxed);
+            commands.pause.store(pause, std::memory_order_relaxed);
+            sink.SetState(pause ? "Paused" : "Running");
+        } else if (c == 'm' || c == 'M') {
+            sink.AddMark();
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!ParseArgs(argc, argv, opt)) {
+        PrintUsage();
+        return 2;
+    }
+    const calibration::Settings& s = opt.settings;
+
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+        std::fprintf(stderr, "BrailleCalibrationTui needs a terminal on stdin and stdout\n");
+        return 1;
+    }
+    winsize ws{};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 &&
+        (s.cols > ws.ws_col || kGridTop + s.rows + 1 > ws.ws_row)) {
+        std::fprintf(stderr, "a %dx%d grid does not fit this %dx%d terminal\n",
+            s.cols, s.rows, (int)ws.ws_col, (int)ws.ws_row);
+        return 1;
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    calibration::SteadyClock clock;
+    calibration::RunnerCommands commands;
+    calibration::Engine engine;
+    TerminalSink sink(s);
+    std::atomic<bool> done{ false };
+
+    {
+        RawTerminal terminal;
+
+        char header[256];
+        const int n = std::snprintf(header, sizeof(header),
+            "\x1b[1;1H%s  %dx%d  on %dms off %dms%s%s\r\n"
+            "S/Esc stop  P/Enter pause  M mark  arrows seek  Home restart",
+            calibration::ToUtf8(calibration::ModeLabel(s.mode)).c_str(), s.cols, s.rows,
+            s.intervalMs, s.OffDurationMs(), s.wholeLine ? "  whole line" : "",
+            s.loop ? "  loop" : "");
+        WriteAll(STDOUT_FILENO, header, (size_t)std::max(0, std::min(n, (int)sizeof(header) - 1)));
+
+        engine.SetClock(&clock);
+        engine.SetSink(&sink);
+        std::thread runner([&] {
+            engine.Start(s, opt.seed);
+            calibration::RunRealTime(engine, clock, commands, std::numeric_limits<std::int64_t>::max());
+            engine.Stop(); // no-op unless the runner returned without stopping
+            sink.SetState("Stopped");
+            done.store(true, std::memory_order_release);
+        });
+
+        while (!done.load(std::memory_order_acquire)) {
+            if (g_signalled) commands.RequestStop(clock);
+
+            pollfd p{ STDIN_FILENO, POLLIN, 0 };
+            if (poll(&p, 1, 50) <= 0) continue;
+            char keys[64];
+            const ssize_t got = ::read(STDIN_FILENO, keys, sizeof(keys));
+            if (got > 0) HandleKeys(keys, (int)got, s, commands, clock, sink);
+        }
+        runner.join();
+    }
+
+    const calibration::Stats& st = engine.GetStats();
+    const calibration::TerminalViewStats vs = sink.ViewStats();
+    std::printf("ticks=%llu framesWritten=%llu late=%llu maxLate=%lldus stopLatency=%lldus\n"
+        "terminal: %llu frames, %llu spans, %llu cells, %.1f bytes/frame\n",
+        (unsigned long long)st.ticks, (unsigned long long)st.framesWritten,
+        (unsigned long long)st.lateTicks, (long long)st.maxLateUs, (long long)st.stopLatencyUs,
+        (unsigned long long)vs.frames, (unsigned long long)vs.spans,
+        (unsigned long long)vs.cellsWritten, vs.frames ? (double)vs.bytes / vs.frames : 0.0);
+
+    const std::vector<Mark> marks = sink.Marks();
+    for (size_t i = 0; i < marks.size(); ++i) {
+        const Mark& m = marks[i];
+        std::printf("mark %zu: cell %d (row %d, col %d) at %.3fs\n", i + 1, m.cell + 1,
+            m.cell / s.cols + 1, m.cell % s.cols + 1, m.atUs / 1e6);
+    }
+    return 0;
+}
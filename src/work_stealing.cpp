@@ -0,0 +1,155 @@
+#include "work_stealing.h"
+
+#include <algorithm>
+
+#include "calibration_engine.h"
+
+namespace calibration {
+
+namespace {
+
+const SteadyClock g_clock{};
+
+int DefaultWorkers(int workers) {
+    if (workers > 0) return workers;
+    const unsigned hw = std::thread::hardware_concurrency();
+    return hw ? (int)hw : 1;
+}
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(int workers)
+    : workers_(DefaultWorkers(workers)), queues_(new Queue[(size_t)DefaultWorkers(workers)]) {
+    for (int w = 1; w < workers_; ++w) {
+        threads_.emplace_back([this, w] { WorkerLoop(w); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& t : threads_) t.join();
+}
+
+void WorkStealingPool::RunBatch(int chunks, ChunkFn fn, void* ctx) {
+    if (chunks <= 0) return;
+    const std::int64_t startUs = g_clock.NowUs();
+
+    {
+        // Refill only once no worker is inside Work(): one woken for the last
+        // batch may just be finding its queues empty. Holding the mutex keeps
+        // late wakers out until the epoch below is set, and publishes the
+        // queues to every worker that wakes for it.
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return active_ == 0; });
+
+        fn_ = fn;
+        ctx_ = ctx;
+        remaining_.store(chunks, std::memory_order_relaxed);
+        for (int w = 0; w < workers_; ++w) {
+            Queue& q = queues_[(size_t)w];
+            q.chunks.clear();
+            for (int c = w; c < chunks; c += workers_) q.chunks.push_back(c);
+            q.head.store(0, std::memory_order_relaxed);
+        }
+        epoch_++;
+    }
+    if (workers_ > 1) wake_.notify_all();
+
+    Work(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return remaining_.load(std::memory_order_acquire) == 0; });
+    batchUs_ += g_clock.NowUs() - startUs;
+}
+
+void WorkStealingPool::WorkerLoop(int worker) {
+    std::uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return quit_ || epoch_ != seen; });
+            if (quit_) return;
+            seen = epoch_;
+            active_++;
+        }
+        Work(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_--;
+        }
+        done_.notify_all();
+    }
+}
+
+void WorkStealingPool::Work(int worker) {
+    WorkerStats& stats = queues_[(size_t)worker].stats;
+    for (;;) {
+        int chunk = -1;
+        bool stolen = false;
+        if (!Take(worker, chunk)) {
+            if (!Steal(worker, chunk)) return;
+            stolen = true;
+        }
+
+        const std::int64_t t0 = g_clock.NowUs();
+        fn_(ctx_, chunk, worker);
+        stats.busyUs += g_clock.NowUs() - t0;
+        stats.chunks++;
+        if (stolen) stats.steals++;
+
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            done_.notify_all();
+        }
+    }
+}
+
+bool WorkStealingPool::Take(int queue, int& chunk) {
+    Queue& q = queues_[(size_t)queue];
+    // Cheap early out, so idle thieves do not push head ever further.
+    if (q.head.load(std::memory_order_relaxed) >= (int)q.chunks.size()) return false;
+
+    const int index = q.head.fetch_add(1, std::memory_order_relaxed);
+    if (index >= (int)q.chunks.size()) return false;
+    chunk = q.chunks[(size_t)index];
+    return true;
+}
+
+bool WorkStealingPool::Steal(int worker, int& chunk) {
+    for (;;) {
+        // Victim: the queue whose front chunk is most urgent.
+        int victim = -1;
+        int best = -1;
+        for (int w = 0; w < workers_; ++w) {
+            if (w == worker) continue;
+            const int front = queues_[(size_t)w].Front();
+            if (front >= 0 && (best < 0 || front < best)) {
+                best = front;
+                victim = w;
+            }
+        }
+        if (victim < 0) return false;
+        if (Take(victim, chunk)) return true;
+    }
+}
+
+int MakeWeightedChunks(const std::vector<int>& weights, int grain, std::vector<int>& bounds) {
+    bounds.clear();
+    const int n = (int)weights.size();
+    int weight = 0;
+    for (int i = 0; i < n; ++i) {
+        if (i == 0 || weight + weights[(size_t)i] > grain) {
+            bounds.push_back(i);
+            weight = 0;
+        }
+        weight += weights[(size_t)i];
+    }
+    bounds.push_back(n);
+    return (int)bounds.size() - 1;
+}
+
+} // namespace calibration
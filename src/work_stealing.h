@@ -0,0 +1,111 @@
+#pragma once
+
+// Work-stealing executor for batches of independent jobs: frame generation for
+// the sessions due in a fleet wake-up, conformance cases.
+//
+// A batch is a number of chunks in priority order, chunk 0 first (for frame
+// generation: the sessions closest to their deadline). Run() deals them
+// round-robin onto per-worker queues so every worker starts on urgent work.
+// A worker takes the front of its own queue; once that is empty it steals the
+// front of whichever queue holds the most urgent chunk, so a batch drains in
+// roughly priority order even when chunk costs are skewed. The calling thread
+// is worker 0; the others sleep between batches.
+//
+// Taking a chunk is lock-free: one fetch_add on the queue's head index, by the
+// owner and by thieves alike. Nothing is pushed while a batch runs (Run() fills
+// the queues before waking the workers and waits until every worker has left
+// before refilling them), so a Chase-Lev deque's push/pop end is not needed;
+// and both sides take the front because the front is the most urgent chunk.
+//
+// Chunking is up to the caller. MakeWeightedChunks() groups consecutive items
+// up to a weight, so cheap items share a chunk and an expensive one gets its own.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace calibration {
+
+struct WorkerStats {
+    std::uint64_t chunks = 0;   // chunks run by this worker
+    std::uint64_t steals = 0;   // of which taken from another worker's queue
+    std::int64_t busyUs = 0;    // time spent running chunks
+};
+
+class WorkStealingPool {
+public:
+    // workers <= 0: one per hardware thread.
+    explicit WorkStealingPool(int workers);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int Workers() const { return workers_; }
+
+    // Calls fn(chunk, worker) for every chunk in [0, chunks) and returns when
+    // all have run. fn must be safe to call concurrently for different chunks.
+    template <typename Fn>
+    void Run(int chunks, Fn&& fn) {
+        using F = std::remove_reference_t<Fn>;
+        RunBatch(chunks, [](void* ctx, int chunk, int worker) { (*static_cast<F*>(ctx))(chunk, worker); },
+            const_cast<void*>(static_cast<const void*>(&fn)));
+    }
+
+    // Per-worker totals since construction; read between batches.
+    const WorkerStats& Stats(int worker) const { return queues_[(size_t)worker].stats; }
+
+    // Wall time spent inside Run(); busyUs / BatchUs() is a worker's utilization.
+    std::int64_t BatchUs() const { return batchUs_; }
+
+private:
+    using ChunkFn = void (*)(void* ctx, int chunk, int worker);
+
+    // One cache line per queue: thieves hammer head.
+    struct alignas(64) Queue {
+        std::vector<int> chunks;        // fixed while a batch runs
+        std::atomic<int> head{ 0 };     // next index to take; may overshoot chunks.size()
+        WorkerStats stats;              // written by the owning worker only
+
+        int Front() const {             // most urgent chunk still queued, -1 if none
+            const int h = head.load(std::memory_order_relaxed);
+            return h < (int)chunks.size() ? chunks[(size_t)h] : -1;
+        }
+    };
+
+    void RunBatch(int chunks, ChunkFn fn, void* ctx);
+    void WorkerLoop(int worker);
+    void Work(int worker);
+    bool Take(int queue, int& chunk);
+    bool Steal(int worker, int& chunk);
+
+    const int workers_;
+    std::unique_ptr<Queue[]> queues_;
+
+    ChunkFn fn_ = nullptr;
+    void* ctx_ = nullptr;
+    std::atomic<int> remaining_{ 0 };
+    std::int64_t batchUs_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::uint64_t epoch_ = 0;
+    int active_ = 0;                    // workers inside Work() for the current batch
+    bool quit_ = false;
+
+    std::vector<std::thread> threads_;
+};
+
+// Splits items [0, weights.size()) into consecutive chunks of at most `grain`
+// total weight (an item heavier than that is a chunk by itself). bounds gets
+// the first item of every chunk plus the item count, so chunk c is
+// [bounds[c], bounds[c + 1]). Returns the number of chunks.
+int MakeWeightedChunks(const std::vector<int>& weights, int grain, std::vector<int>& bounds);
+
+} // namespace calibration